@@ -0,0 +1,343 @@
+/**
+ * @file bench_main.cpp
+ * @brief Host microbenchmarks for the update, evaluation and CV-load hot paths, and the
+ *        timer tick.
+ *
+ * Every benchmark reports the time per operation, the heap allocations per operation and
+ * the peak live heap while it ran, which includes the loaded configuration. Heap figures come
+ * from the replaced global operator new/delete below, so they cover the library and the
+ * standard containers it uses.
+ *
+ * Usage: xdr_bench [filter]   (runs only benchmarks whose name contains filter)
+ */
+#include <Arduino.h>
+#include <MemoryCVAccess.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <string>
+#include "xDuinoRails_DccLightsAndFunctions.h"
+#include "cv_definitions.h"
+#include "LightSources/CharlieplexedLeds.h"
+#include "LightSources/SingleLed.h"
+#include "LightSources/SoftPwmLed.h"
+
+using namespace xDuinoRails;
+
+// --- Heap accounting ---
+
+namespace {
+struct HeapStats {
+    size_t allocations = 0;
+    size_t current_bytes = 0;
+    size_t peak_bytes = 0;
+};
+HeapStats g_heap;
+}
+
+void* operator new(size_t size) {
+    size_t* block = static_cast<size_t*>(std::malloc(size + sizeof(size_t) * 2));
+    if (!block) throw std::bad_alloc();
+    block[0] = size;
+    ++g_heap.allocations;
+    g_heap.current_bytes += size;
+    if (g_heap.current_bytes > g_heap.peak_bytes) g_heap.peak_bytes = g_heap.current_bytes;
+    return block + 2;
+}
+
+void operator delete(void* ptr) noexcept {
+    if (!ptr) return;
+    size_t* block = static_cast<size_t*>(ptr) - 2;
+    g_heap.current_bytes -= block[0];
+    std::free(block);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    operator delete(ptr);
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete[](void* ptr) noexcept {
+    operator delete(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    operator delete(ptr);
+}
+
+// --- Harness ---
+
+namespace {
+
+const char* g_filter = nullptr;
+int g_failures = 0; ///< Benchmarks that missed a required relation to another.
+
+/**
+ * @brief Times `op` over `iterations` calls after one warm-up call.
+ * @return ns/op, or 0 if the filter skipped the benchmark.
+ */
+double runBenchmark(const std::string& name, uint32_t iterations,
+                    const std::function<void()>& op) {
+    if (g_filter && name.find(g_filter) == std::string::npos) return 0;
+
+    op(); // warm-up, lets lazily grown containers reach their steady size
+
+    size_t allocs_before = g_heap.allocations;
+    g_heap.peak_bytes = g_heap.current_bytes;
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; ++i) {
+        op();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+    double allocs = (double)(g_heap.allocations - allocs_before) / iterations;
+    std::printf("%-40s %12.1f ns/op %10.2f allocs/op %10zu B peak heap\n",
+                name.c_str(), ns, allocs, g_heap.peak_bytes);
+    return ns;
+}
+
+const char* methodName(FunctionMappingMethod method) {
+    switch (method) {
+        case FunctionMappingMethod::RCN_225: return "rcn225";
+        case FunctionMappingMethod::RCN_227_PER_FUNCTION: return "rcn227_per_function";
+        case FunctionMappingMethod::RCN_227_PER_OUTPUT_V1: return "rcn227_per_output_v1";
+        case FunctionMappingMethod::RCN_227_PER_OUTPUT_V2: return "rcn227_per_output_v2";
+        case FunctionMappingMethod::RCN_227_PER_OUTPUT_V3: return "rcn227_per_output_v3";
+        default: return "proprietary";
+    }
+}
+
+const int kNumOutputs = 32;
+
+/** @brief Fills the effects block with one effect type for every output. */
+void writeEffects(MemoryCVAccess& cvs, uint8_t effect_type) {
+    for (int output = 0; output < kNumOutputs; ++output) {
+        uint16_t base = 257 + output * EFFECTS_BLOCK_CV_PER_OUTPUT;
+        cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, base + EFFECTS_CV_OFFSET_TYPE, effect_type);
+        cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, base + EFFECTS_CV_OFFSET_PARAM1_LSB, 200);
+        cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, base + EFFECTS_CV_OFFSET_PARAM2_LSB, 50);
+        cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, base + EFFECTS_CV_OFFSET_PARAM3_LSB, 100);
+    }
+}
+
+/** @brief Writes the densest configuration each mapping method allows. */
+void writeMaximumMapping(MemoryCVAccess& cvs, FunctionMappingMethod method) {
+    cvs.writeCV(CV_FUNCTION_MAPPING_METHOD, (uint8_t)method);
+    switch (method) {
+        case FunctionMappingMethod::RCN_225:
+            for (int cv = CV_OUTPUT_LOCATION_CONFIG_START; cv <= CV_OUTPUT_LOCATION_CONFIG_END; ++cv) {
+                cvs.writeCV(cv, 0xFF);
+            }
+            break;
+        case FunctionMappingMethod::RCN_227_PER_FUNCTION:
+            for (int entry = 0; entry < 64; ++entry) {
+                uint16_t base = 257 + entry * 4;
+                for (int i = 0; i < 3; ++i) cvs.writeIndexedCV(RCN227_PER_FUNCTION_PAGE, base + i, 0xFF);
+                cvs.writeIndexedCV(RCN227_PER_FUNCTION_PAGE, base + 3, (uint8_t)(entry % 29));
+            }
+            break;
+        case FunctionMappingMethod::RCN_227_PER_OUTPUT_V1:
+            for (int entry = 0; entry < 48; ++entry) {
+                for (int i = 0; i < 4; ++i) cvs.writeIndexedCV(RCN227_PER_OUTPUT_V1_PAGE, 257 + entry * 4 + i, 0xFF);
+            }
+            break;
+        case FunctionMappingMethod::RCN_227_PER_OUTPUT_V2:
+            for (int entry = 0; entry < 64; ++entry) {
+                uint16_t base = 257 + entry * 4;
+                for (int i = 0; i < 3; ++i) {
+                    cvs.writeIndexedCV(RCN227_PER_OUTPUT_V2_PAGE, base + i, (uint8_t)((entry + i) % 29));
+                }
+                cvs.writeIndexedCV(RCN227_PER_OUTPUT_V2_PAGE, base + 3, (uint8_t)(28 - entry % 29));
+            }
+            break;
+        case FunctionMappingMethod::RCN_227_PER_OUTPUT_V3:
+            for (int output = 0; output < kNumOutputs; ++output) {
+                uint16_t base = 257 + output * 8;
+                for (int i = 0; i < 4; ++i) {
+                    uint8_t dir_bits = (uint8_t)(i % 3);
+                    cvs.writeIndexedCV(RCN227_PER_OUTPUT_V3_PAGE, base + i, (uint8_t)((dir_bits << 6) | ((output + i) % 29)));
+                }
+                cvs.writeIndexedCV(RCN227_PER_OUTPUT_V3_PAGE, base + 4, 0x80);
+                cvs.writeIndexedCV(RCN227_PER_OUTPUT_V3_PAGE, base + 5, (uint8_t)(output % 29));
+                cvs.writeIndexedCV(RCN227_PER_OUTPUT_V3_PAGE, base + 6, 0x00);
+                cvs.writeIndexedCV(RCN227_PER_OUTPUT_V3_PAGE, base + 7, 70);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void addOutputs(AuxController& controller) {
+    for (int pin = 1; pin <= kNumOutputs; ++pin) {
+        controller.addPhysicalOutput((uint8_t)pin, OutputType::LIGHT_SOURCE);
+    }
+}
+
+void benchmarkMappingMethod(FunctionMappingMethod method) {
+    std::string prefix = methodName(method);
+    MemoryCVAccess cvs;
+    writeMaximumMapping(cvs, method);
+    writeEffects(cvs, EFFECT_TYPE_NONE);
+
+    AuxController controller;
+    addOutputs(controller);
+
+    double parse_ns = runBenchmark(prefix + "/loadFromCVs", 20, [&]() {
+        controller.loadFromCVs(cvs);
+    });
+
+    std::vector<uint8_t> image;
+    controller.saveMappingImage(cvs, image);
+    double image_ns = runBenchmark(prefix + "/loadFromImage(" + std::to_string(image.size()) + " B)", 20, [&]() {
+        controller.loadFromImage(cvs, image);
+    });
+    // The image exists to make booting cheaper than parsing; fail the run if it is not.
+    if (parse_ns > 0 && image_ns >= parse_ns) {
+        std::printf("FAIL: %s/loadFromImage is not faster than loadFromCVs\n", prefix.c_str());
+        ++g_failures;
+    }
+
+    controller.loadFromCVs(cvs);
+    uint8_t param1 = 200;
+    runBenchmark(prefix + "/reloadCV(effect)", 200, [&]() {
+        param1 ^= 1;
+        cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, 257 + EFFECTS_CV_OFFSET_PARAM1_LSB, param1);
+        controller.reloadCV(cvs, EFFECTS_BLOCK_PAGE, 257 + EFFECTS_CV_OFFSET_PARAM1_LSB);
+    });
+
+    for (int f = 0; f < MAX_DCC_FUNCTIONS; f += 2) controller.setFunctionState(f, true);
+    controller.update(1);
+
+    runBenchmark(prefix + "/update(full evaluation)", 2000, [&]() {
+        controller.forceFullEvaluation();
+        controller.update(1);
+    });
+
+    bool f1 = false;
+    runBenchmark(prefix + "/update(F1 toggled)", 2000, [&]() {
+        f1 = !f1;
+        controller.setFunctionState(1, f1);
+        controller.update(1);
+    });
+
+    runBenchmark(prefix + "/update(steady)", 2000, [&]() {
+        controller.update(1);
+    });
+}
+
+struct EffectCase {
+    const char* name;
+    Effect* effect;
+};
+
+void benchmarkEffects() {
+    // The effects loadFromCVs() builds from the parameters writeEffects() stores (200, 50, 100).
+    const EffectCase cases[] = {
+        {"steady", new EffectSteady(255)},
+        {"dimming", new EffectDimming(200, 50)},
+        {"flicker", new EffectFlicker(200, 50, 100)},
+        {"strobe", new EffectStrobe(200, 50, 100)},
+        {"mars_light", new EffectMarsLight(200, 50, 100)},
+        {"soft_start_stop", new EffectSoftStartStop(200, 50, 100)},
+        {"servo", new EffectServo(200, 50, 100)},
+        {"smoke_generator", new EffectSmokeGenerator(true, 50)},
+    };
+    for (const auto& c : cases) {
+        Effect* effect = c.effect;
+        PhysicalOutput output(std::unique_ptr<LightSource>(new SingleLed(3)));
+        output.begin();
+        std::vector<PhysicalOutput*> outputs(1, &output);
+        effect->setActive(true);
+        runBenchmark(std::string("effect/") + c.name, 20000, [&]() {
+            effect->update(1, outputs);
+        });
+        delete effect;
+    }
+
+    EffectFire fire(55, 120, 8);
+    std::vector<PhysicalOutput> strip;
+    strip.reserve(8);
+    std::vector<PhysicalOutput*> outputs;
+    for (uint8_t pin = 0; pin < 8; ++pin) {
+        strip.emplace_back(std::unique_ptr<LightSource>(new SingleLed(pin)));
+        strip.back().begin();
+        outputs.push_back(&strip.back());
+    }
+    fire.setActive(true);
+    runBenchmark("effect/fire(8)", 20000, [&]() {
+        fire.update(1, outputs);
+    });
+}
+
+void benchmarkMixedEffectUpdate() {
+    MemoryCVAccess cvs;
+    writeMaximumMapping(cvs, FunctionMappingMethod::RCN_227_PER_OUTPUT_V3);
+    for (int output = 0; output < kNumOutputs; ++output) {
+        uint16_t base = 257 + output * EFFECTS_BLOCK_CV_PER_OUTPUT;
+        cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, base + EFFECTS_CV_OFFSET_TYPE, (uint8_t)(output % 6));
+        cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, base + EFFECTS_CV_OFFSET_PARAM1_LSB, 200);
+        cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, base + EFFECTS_CV_OFFSET_PARAM2_LSB, 50);
+        cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, base + EFFECTS_CV_OFFSET_PARAM3_LSB, 100);
+    }
+    AuxController controller;
+    addOutputs(controller);
+    controller.loadFromCVs(cvs);
+    for (int f = 0; f < MAX_DCC_FUNCTIONS; ++f) controller.setFunctionState(f, true);
+    controller.update(1);
+    runBenchmark("mixed_effects_32/update(steady)", 2000, [&]() {
+        controller.update(1);
+    });
+}
+
+void benchmarkTick() {
+    SoftPwm pwm;
+    std::vector<std::unique_ptr<LightSource>> leds;
+    for (uint8_t pin = 0; pin < 8; ++pin) {
+        leds.emplace_back(new SoftPwmLed(pwm, pin));
+        leds.back()->begin();
+        leds.back()->setLevel((uint8_t)(pin * 32 + 1));
+    }
+    runBenchmark("tick/soft_pwm(8 pins)", 255 * 100, [&]() {
+        pwm.tick();
+    });
+
+    CharlieplexedLeds charlieplex(pwm, {8, 9, 10, 11, 12});
+    charlieplex.begin();
+    charlieplex.setLevel(255);
+    for (uint8_t led = 0; led < charlieplex.ledCount(); ++led) charlieplex.setLedLevel(led, (uint8_t)(led * 13));
+    charlieplex.commit();
+    runBenchmark("tick/soft_pwm(8 pins)+charlieplex(20 leds)", 255 * 100, [&]() {
+        pwm.tick();
+    });
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc > 1) g_filter = argv[1];
+    VirtualHardware::setRecording(false);
+
+    const FunctionMappingMethod methods[] = {
+        FunctionMappingMethod::RCN_225,
+        FunctionMappingMethod::RCN_227_PER_FUNCTION,
+        FunctionMappingMethod::RCN_227_PER_OUTPUT_V1,
+        FunctionMappingMethod::RCN_227_PER_OUTPUT_V2,
+        FunctionMappingMethod::RCN_227_PER_OUTPUT_V3,
+    };
+    for (auto method : methods) {
+        benchmarkMappingMethod(method);
+    }
+    benchmarkEffects();
+    benchmarkMixedEffectUpdate();
+    benchmarkTick();
+    return g_failures ? 1 : 0;
+}
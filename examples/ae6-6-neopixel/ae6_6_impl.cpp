@@ -2,8 +2,7 @@
 #undef min
 #undef max
 #include <xDuinoRails_DccLightsAndFunctions.h>
-#include <LightSources/NeopixelRgbMulti.h>
-#include <LightSources/NeopixelRgbMultiSwissAe66.h>
+#include <LightSources/NeopixelStrip.h>
 #include <cv_definitions.h>
 #include <interfaces/ICVAccess.h>
 #include <map>
@@ -11,9 +10,9 @@
 #include <vector>
 #include "ae6_6_impl.h"
 
-// Define the pins for the Neopixel strips
-#define FRONT_LIGHT_PIN 6
-#define BACK_LIGHT_PIN 7
+// One Neopixel strip carries all lights: 3 front pixels, 3 back pixels and 1 cab pixel
+#define LIGHT_STRIP_PIN 6
+#define LIGHT_STRIP_PIXELS 7
 
 using namespace xDuinoRails;
 
@@ -21,6 +20,9 @@ using namespace xDuinoRails;
 // We use a static or global instance here
 static AuxController controller;
 
+// The strip must outlive the segments that draw into it
+static NeopixelStrip lightStrip(LIGHT_STRIP_PIN, LIGHT_STRIP_PIXELS);
+
 // Mock implementation of ICVAccess for this example
 class MockCVAccess : public ICVAccess {
 public:
@@ -47,15 +49,19 @@ void ae6_6_setup() {
 
     Serial.println("AE6/6 Neopixel Example");
 
-    // Create the light sources for the front and back lights (3 pixels each)
-    // Front lights are white
-    auto frontLights = std::unique_ptr<NeopixelRgbMulti>(new NeopixelRgbMulti(FRONT_LIGHT_PIN, 3, 255, 255, 255));
-    // Back lights are red
-    auto backLights = std::unique_ptr<NeopixelRgbMultiSwissAe66>(new NeopixelRgbMultiSwissAe66(BACK_LIGHT_PIN, 3, 255, 0, 0));
+    // Create one segment light source per lamp group on the shared strip.
+    // Front lights are white (pixels 0-2)
+    auto frontLights = std::unique_ptr<NeopixelSegment>(new NeopixelSegment(lightStrip, 0, 3, 255, 255, 255));
+    // Back lights are red, outer two of pixels 3-5 only (Swiss tail lights)
+    auto backLights = std::unique_ptr<NeopixelSegment>(new NeopixelSegment(lightStrip, 3, 2, 255, 0, 0, 2));
+    // Cab light is warm white (pixel 6)
+    auto cabLight = std::unique_ptr<NeopixelSegment>(new NeopixelSegment(lightStrip, 6, 1, 255, 180, 100));
 
-    // Add the light sources to the controller. They get assigned output IDs 0 and 1.
+    // Add the light sources to the controller. They get assigned output IDs 1, 2 and 3.
+    // The strip is transmitted once per update, however many segments changed.
     controller.addLightSource(std::move(frontLights));
     controller.addLightSource(std::move(backLights));
+    controller.addLightSource(std::move(cabLight));
 
     // Create a mock CV access object and configure it
     MockCVAccess cvAccess;
@@ -63,16 +69,20 @@ void ae6_6_setup() {
     // Use the RCN-225 mapping method
     cvAccess.writeCV(CV_FUNCTION_MAPPING_METHOD, (uint8_t)FunctionMappingMethod::RCN_225);
 
-    // Map front lights (Output 0) to F0 Forward.
+    // Map front lights (Output 1) to F0 Forward.
     // CV 33 (CV_OUTPUT_LOCATION_CONFIG_START) controls F0f.
-    // We set bit 0 to map Output 0.
+    // We set bit 0 to map Output 1.
     cvAccess.writeCV(CV_OUTPUT_LOCATION_CONFIG_START, 1 << 0);
 
-    // Map back lights (Output 1) to F0 Reverse.
+    // Map back lights (Output 2) to F0 Reverse.
     // CV 34 (CV_OUTPUT_LOCATION_CONFIG_START + 1) controls F0b.
-    // We set bit 1 to map Output 1.
+    // We set bit 1 to map Output 2.
     cvAccess.writeCV(CV_OUTPUT_LOCATION_CONFIG_START + 1, 1 << 1);
 
+    // Map the cab light (Output 3) to F1.
+    // CV 35 (CV_OUTPUT_LOCATION_CONFIG_START + 2) controls F1.
+    cvAccess.writeCV(CV_OUTPUT_LOCATION_CONFIG_START + 2, 1 << 2);
+
     // Load the configuration from our mock CVs
     controller.loadFromCVs(cvAccess);
 
@@ -0,0 +1,47 @@
+#include "Adafruit_NeoPixel.h"
+#include "VirtualHardware.h"
+
+using VirtualHardware::EventType;
+
+Adafruit_NeoPixel::Adafruit_NeoPixel(uint16_t n, int16_t pin, neoPixelType type) :
+    _pixels(n, 0),
+    _pin(pin)
+{
+    (void)type;
+}
+
+void Adafruit_NeoPixel::begin() {
+    VirtualHardware::record(EventType::PIN_MODE, (uint16_t)_pin, 1);
+}
+
+void Adafruit_NeoPixel::show() {
+    ++_show_count;
+    VirtualHardware::record(EventType::STRIP_SHOW, (uint16_t)_pin, (uint32_t)_pixels.size());
+}
+
+void Adafruit_NeoPixel::setPixelColor(uint16_t n, uint32_t c) {
+    if (n < _pixels.size()) _pixels[n] = c & 0xFFFFFF;
+}
+
+void Adafruit_NeoPixel::setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b) {
+    setPixelColor(n, Color(r, g, b));
+}
+
+void Adafruit_NeoPixel::setBrightness(uint8_t b) {
+    _brightness = b;
+}
+
+void Adafruit_NeoPixel::clear() {
+    for (auto& p : _pixels) p = 0;
+}
+
+uint32_t Adafruit_NeoPixel::getPixelColor(uint16_t n) const {
+    if (n >= _pixels.size()) return 0;
+    uint32_t c = _pixels[n];
+    if (_brightness == 255) return c;
+    uint16_t scale = (uint16_t)_brightness + 1;
+    uint8_t r = (uint8_t)((((c >> 16) & 0xFF) * scale) >> 8);
+    uint8_t g = (uint8_t)((((c >> 8) & 0xFF) * scale) >> 8);
+    uint8_t b = (uint8_t)(((c & 0xFF) * scale) >> 8);
+    return Color(r, g, b);
+}
@@ -0,0 +1,73 @@
+#include "Arduino.h"
+#include <cstdio>
+
+using VirtualHardware::EventType;
+
+HostSerial Serial;
+
+void pinMode(uint8_t pin, uint8_t mode) {
+    VirtualHardware::record(EventType::PIN_MODE, pin, mode);
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+    VirtualHardware::record(EventType::DIGITAL_WRITE, pin, val ? HIGH : LOW);
+}
+
+int digitalRead(uint8_t pin) {
+    return VirtualHardware::pinValue(pin) ? HIGH : LOW;
+}
+
+void analogWrite(uint8_t pin, int val) {
+    VirtualHardware::record(EventType::ANALOG_WRITE, pin, (uint32_t)constrain(val, 0, 255));
+}
+
+unsigned long millis() {
+    return (unsigned long)(VirtualHardware::nowMicros() / 1000);
+}
+
+unsigned long micros() {
+    return (unsigned long)VirtualHardware::nowMicros();
+}
+
+void delay(unsigned long ms) {
+    VirtualHardware::advanceMillis(ms);
+}
+
+void delayMicroseconds(unsigned int us) {
+    VirtualHardware::advanceMicros(us);
+}
+
+void noInterrupts() {}
+void interrupts() {}
+
+long random(long howbig) {
+    return (howbig <= 0) ? 0 : std::rand() % howbig;
+}
+
+long random(long howsmall, long howbig) {
+    return (howsmall >= howbig) ? howsmall : howsmall + random(howbig - howsmall);
+}
+
+void randomSeed(unsigned long seed) {
+    std::srand((unsigned)seed);
+}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max) {
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+size_t HostSerial::print(const char* s) {
+    return (size_t)std::printf("%s", s);
+}
+
+size_t HostSerial::print(long n) {
+    return (size_t)std::printf("%ld", n);
+}
+
+size_t HostSerial::println(const char* s) {
+    return (size_t)std::printf("%s\n", s);
+}
+
+size_t HostSerial::println(long n) {
+    return (size_t)std::printf("%ld\n", n);
+}
@@ -0,0 +1,94 @@
+#include "FastLED.h"
+
+uint16_t rand16seed = 1337;
+
+uint8_t random8() {
+    rand16seed = (rand16seed * 2053) + 13849;
+    return (uint8_t)((uint8_t)(rand16seed & 0xFF) + (uint8_t)(rand16seed >> 8));
+}
+
+uint8_t random8(uint8_t lim) {
+    return (uint8_t)(((uint16_t)random8() * lim) >> 8);
+}
+
+uint8_t random8(uint8_t min, uint8_t lim) {
+    return (uint8_t)(min + random8((uint8_t)(lim - min)));
+}
+
+uint16_t random16() {
+    rand16seed = (rand16seed * 2053) + 13849;
+    return rand16seed;
+}
+
+uint16_t random16(uint16_t lim) {
+    return (uint16_t)(((uint32_t)random16() * lim) >> 16);
+}
+
+void random16_set_seed(uint16_t seed) {
+    rand16seed = seed;
+}
+
+uint8_t scale8(uint8_t i, fract8 scale) {
+    return (uint8_t)(((uint16_t)i * (1 + (uint16_t)scale)) >> 8);
+}
+
+uint8_t qadd8(uint8_t i, uint8_t j) {
+    unsigned int t = i + j;
+    return (uint8_t)(t > 255 ? 255 : t);
+}
+
+uint8_t qsub8(uint8_t i, uint8_t j) {
+    return (uint8_t)(i > j ? i - j : 0);
+}
+
+uint8_t sin8(uint8_t theta) {
+    static const uint8_t b_m16_interleave[] = { 0, 49, 49, 41, 90, 27, 117, 10 };
+    uint8_t offset = theta;
+    if (theta & 0x40) offset = (uint8_t)255 - offset;
+    offset &= 0x3F;
+    uint8_t secoffset = offset & 0x0F;
+    if (theta & 0x40) secoffset++;
+    uint8_t section = offset >> 4;
+    const uint8_t* p = b_m16_interleave + section * 2;
+    uint8_t b = p[0];
+    uint8_t m16 = p[1];
+    uint8_t mx = (uint8_t)((m16 * secoffset) >> 4);
+    int8_t y = (int8_t)(mx + b);
+    if (theta & 0x80) y = (int8_t)-y;
+    return (uint8_t)(y + 128);
+}
+
+namespace {
+uint8_t latticeValue(uint8_t cell) {
+    uint16_t h = (uint16_t)(cell * 0x9E37u) ^ 0x5BD1u;
+    h ^= h >> 7;
+    h = (uint16_t)(h * 0x2C1Bu);
+    return (uint8_t)(h >> 8);
+}
+}
+
+uint8_t inoise8(uint16_t x) {
+    uint8_t cell = (uint8_t)(x >> 8);
+    uint8_t frac = (uint8_t)(x & 0xFF);
+    // Smoothstep fade: 3f^2 - 2f^3 in 0.8 fixed point.
+    uint16_t f2 = ((uint16_t)frac * frac) >> 8;
+    uint16_t f3 = (f2 * frac) >> 8;
+    uint16_t fade = (uint16_t)(3 * f2 - 2 * f3);
+    int16_t a = latticeValue(cell);
+    int16_t b = latticeValue((uint8_t)(cell + 1));
+    return (uint8_t)(a + (((int32_t)(b - a) * fade) >> 8));
+}
+
+uint8_t beat8(accum88 beats_per_minute, uint32_t timebase) {
+    uint32_t bpm88 = beats_per_minute;
+    if (bpm88 < 256) bpm88 <<= 8;
+    return (uint8_t)((((millis() - timebase) * bpm88 * 280) >> 16) >> 8);
+}
+
+uint8_t beatsin8(accum88 beats_per_minute, uint8_t lowest, uint8_t highest,
+                 uint32_t timebase, uint8_t phase_offset) {
+    uint8_t beat = beat8(beats_per_minute, timebase);
+    uint8_t beatsin = sin8((uint8_t)(beat + phase_offset));
+    uint8_t rangewidth = (uint8_t)(highest - lowest);
+    return (uint8_t)(lowest + scale8(beatsin, rangewidth));
+}
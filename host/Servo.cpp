@@ -0,0 +1,21 @@
+#include "Servo.h"
+#include "VirtualHardware.h"
+
+using VirtualHardware::EventType;
+
+uint8_t Servo::attach(int pin) {
+    _pin = pin;
+    VirtualHardware::record(EventType::SERVO_ATTACH, (uint16_t)pin, 0);
+    return 0;
+}
+
+void Servo::detach() {
+    _pin = -1;
+}
+
+void Servo::write(int value) {
+    if (value < 0) value = 0;
+    if (value > 180) value = 180;
+    _angle = value;
+    VirtualHardware::record(EventType::SERVO_WRITE, (uint16_t)_pin, (uint32_t)value);
+}
@@ -0,0 +1,153 @@
+#include "VirtualHardware.h"
+#include <map>
+
+namespace VirtualHardware {
+
+namespace {
+std::vector<Event> s_events;
+std::map<uint8_t, uint32_t> s_pin_values;
+std::map<uint8_t, uint8_t> s_pin_modes;
+uint64_t s_now_us = 0;
+bool s_recording = true;
+void (*s_timer_callback)() = nullptr;
+uint32_t s_timer_period_us = 0;
+uint64_t s_timer_next_us = 0;
+const int kPortCount = 32;
+PortRegister s_output_registers[kPortCount];
+PortRegister s_mode_registers[kPortCount];
+}
+
+void reset() {
+    s_events.clear();
+    s_pin_values.clear();
+    s_pin_modes.clear();
+    s_now_us = 0;
+    s_recording = true;
+    detachTimer();
+}
+
+void setRecording(bool enabled) {
+    s_recording = enabled;
+}
+
+bool isRecording() {
+    return s_recording;
+}
+
+void record(EventType type, uint16_t id, uint32_t value) {
+    if (type == EventType::DIGITAL_WRITE || type == EventType::ANALOG_WRITE) {
+        s_pin_values[(uint8_t)id] = value;
+    } else if (type == EventType::PIN_MODE) {
+        s_pin_modes[(uint8_t)id] = (uint8_t)value;
+    }
+    if (s_recording) {
+        s_events.push_back({s_now_us, type, id, value});
+    }
+}
+
+const std::vector<Event>& events() {
+    return s_events;
+}
+
+void clearEvents() {
+    s_events.clear();
+}
+
+size_t count(EventType type, int id) {
+    size_t n = 0;
+    for (const auto& e : s_events) {
+        if (e.type == type && (id < 0 || e.id == id)) ++n;
+    }
+    return n;
+}
+
+uint64_t nowMicros() {
+    return s_now_us;
+}
+
+void advanceMicros(uint64_t us) {
+    uint64_t target_us = s_now_us + us;
+    while (s_timer_callback && s_timer_next_us <= target_us) {
+        s_now_us = s_timer_next_us;
+        s_timer_next_us += s_timer_period_us;
+        s_timer_callback();
+    }
+    s_now_us = target_us;
+}
+
+void advanceMillis(uint32_t ms) {
+    advanceMicros((uint64_t)ms * 1000);
+}
+
+uint32_t pinValue(uint8_t pin) {
+    auto it = s_pin_values.find(pin);
+    return (it != s_pin_values.end()) ? it->second : 0;
+}
+
+uint8_t modeOf(uint8_t pin) {
+    auto it = s_pin_modes.find(pin);
+    return (it != s_pin_modes.end()) ? it->second : 0;
+}
+
+uint64_t highTimeMicros(uint8_t pin, uint64_t from_us, uint64_t to_us) {
+    uint64_t total = 0;
+    bool high = false;
+    uint64_t since = from_us;
+    for (const auto& e : s_events) {
+        if (e.type != EventType::DIGITAL_WRITE || e.id != pin) continue;
+        if (e.time_us >= to_us) break;
+        if (e.time_us > from_us) {
+            if (high) total += e.time_us - since;
+            since = e.time_us;
+        }
+        high = e.value != 0;
+    }
+    if (high) total += to_us - since;
+    return total;
+}
+
+PortRegister::operator uint8_t() const {
+    uint8_t value = 0;
+    for (uint8_t bit = 0; bit < 8; ++bit) {
+        uint8_t pin = (uint8_t)(_port * 8 + bit);
+        bool set = _mode ? modeOf(pin) == 1 : pinValue(pin) != 0;
+        if (set) value |= (uint8_t)(1 << bit);
+    }
+    return value;
+}
+
+PortRegister& PortRegister::operator=(uint8_t value) {
+    uint8_t changed = (uint8_t)(value ^ (uint8_t)*this);
+    for (uint8_t bit = 0; bit < 8; ++bit) {
+        if (!(changed & (1 << bit))) continue;
+        bool set = value & (1 << bit);
+        uint8_t pin = (uint8_t)(_port * 8 + bit);
+        if (_mode) record(EventType::PIN_MODE, pin, set ? 1 : 0);
+        else record(EventType::DIGITAL_WRITE, pin, set ? 1 : 0);
+    }
+    return *this;
+}
+
+PortRegister* outputRegister(uint8_t port) {
+    if (port >= kPortCount) return nullptr;
+    s_output_registers[port] = PortRegister(port, false);
+    return &s_output_registers[port];
+}
+
+PortRegister* modeRegister(uint8_t port) {
+    if (port >= kPortCount) return nullptr;
+    s_mode_registers[port] = PortRegister(port, true);
+    return &s_mode_registers[port];
+}
+
+void attachTimer(uint32_t period_us, void (*callback)()) {
+    s_timer_callback = callback;
+    s_timer_period_us = period_us > 0 ? period_us : 1;
+    s_timer_next_us = s_now_us + s_timer_period_us;
+}
+
+void detachTimer() {
+    s_timer_callback = nullptr;
+}
+
+} // namespace VirtualHardware
@@ -0,0 +1,50 @@
+/**
+ * @file Adafruit_NeoPixel.h
+ * @brief Host stand-in for the Adafruit NeoPixel library, backed by VirtualHardware.
+ *
+ * Pixel data is kept unscaled in a plain RGB buffer. getPixelColor() returns the value that
+ * would be transmitted, i.e. scaled by the strip brightness; show() is recorded as an event.
+ */
+#ifndef XDRAILS_HOST_ADAFRUIT_NEOPIXEL_H
+#define XDRAILS_HOST_ADAFRUIT_NEOPIXEL_H
+
+#include <cstdint>
+#include <vector>
+
+#define NEO_RGB ((0 << 6) | (0 << 4) | (1 << 2) | (2))
+#define NEO_GRB ((1 << 6) | (1 << 4) | (0 << 2) | (2))
+#define NEO_KHZ800 0x0000
+#define NEO_KHZ400 0x0100
+
+typedef uint16_t neoPixelType;
+
+class Adafruit_NeoPixel {
+public:
+    Adafruit_NeoPixel(uint16_t n, int16_t pin = 6, neoPixelType type = NEO_GRB + NEO_KHZ800);
+
+    void begin();
+    void show();
+    void setPixelColor(uint16_t n, uint32_t c);
+    void setPixelColor(uint16_t n, uint8_t r, uint8_t g, uint8_t b);
+    void setBrightness(uint8_t b);
+    void clear();
+
+    uint32_t getPixelColor(uint16_t n) const;
+    uint8_t getBrightness() const { return _brightness; }
+    uint16_t numPixels() const { return (uint16_t)_pixels.size(); }
+    int16_t getPin() const { return _pin; }
+    /** @brief Host-only: number of times show() was called on this strip. */
+    uint32_t showCount() const { return _show_count; }
+
+    static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) {
+        return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+    }
+
+private:
+    std::vector<uint32_t> _pixels;
+    int16_t _pin;
+    uint8_t _brightness = 255;
+    uint32_t _show_count = 0;
+};
+
+#endif // XDRAILS_HOST_ADAFRUIT_NEOPIXEL_H
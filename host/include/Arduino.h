@@ -0,0 +1,81 @@
+/**
+ * @file Arduino.h
+ * @brief Host stand-in for the Arduino core, backed by VirtualHardware.
+ *
+ * Only the subset of the Arduino API that the library and its examples use is provided.
+ * Pin accesses are recorded with a virtual timestamp; millis()/micros() read the virtual clock.
+ */
+#ifndef XDRAILS_HOST_ARDUINO_H
+#define XDRAILS_HOST_ARDUINO_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include "VirtualHardware.h"
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+// Marks the host build, for the few places that pick a hardware backend (e.g. the tick timer).
+#define XDRAILS_VIRTUAL_HARDWARE 1
+
+// Virtual ports of 8 pins each (see VirtualHardware::PortRegister).
+#define digitalPinToPort(P) ((uint8_t)((P) / 8))
+#define digitalPinToBitMask(P) ((uint8_t)(1 << ((P) % 8)))
+#define portOutputRegister(P) (VirtualHardware::outputRegister(P))
+#define portModeRegister(P) (VirtualHardware::modeRegister(P))
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+void analogWrite(uint8_t pin, int val);
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void noInterrupts();
+void interrupts();
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+long map(long x, long in_min, long in_max, long out_min, long out_max);
+
+template <typename T, typename L, typename H>
+inline T constrain(T amt, L low, H high) {
+    return (amt < low) ? (T)low : ((amt > high) ? (T)high : amt);
+}
+
+/**
+ * @class HostSerial
+ * @brief Minimal Serial replacement that prints to stdout.
+ */
+class HostSerial {
+public:
+    void begin(unsigned long baud) { (void)baud; }
+    size_t print(const char* s);
+    size_t print(long n);
+    size_t println(const char* s = "");
+    size_t println(long n);
+    explicit operator bool() const { return true; }
+};
+
+extern HostSerial Serial;
+
+#endif // XDRAILS_HOST_ARDUINO_H
@@ -0,0 +1,47 @@
+/**
+ * @file FastLED.h
+ * @brief Host stand-in for the parts of FastLED used by the effects (math, noise, RNG).
+ *
+ * The 8-bit helpers follow the FastLED reference implementations. inoise8 is a smooth
+ * value-noise rather than FastLED's Perlin noise; it has the same range and continuity,
+ * which is all the effects rely on. beatsin8 reads the virtual clock through millis().
+ */
+#ifndef XDRAILS_HOST_FASTLED_H
+#define XDRAILS_HOST_FASTLED_H
+
+#include <cstdint>
+#include "Arduino.h"
+
+typedef uint8_t fract8;
+typedef uint16_t accum88;
+
+struct CRGB {
+    uint8_t r = 0;
+    uint8_t g = 0;
+    uint8_t b = 0;
+    CRGB() {}
+    CRGB(uint8_t ir, uint8_t ig, uint8_t ib) : r(ir), g(ig), b(ib) {}
+};
+
+/** @brief Host-only: seed of the shared 16-bit RNG (FastLED's rand16seed). */
+extern uint16_t rand16seed;
+
+uint8_t random8();
+uint8_t random8(uint8_t lim);
+uint8_t random8(uint8_t min, uint8_t lim);
+uint16_t random16();
+uint16_t random16(uint16_t lim);
+void random16_set_seed(uint16_t seed);
+
+uint8_t scale8(uint8_t i, fract8 scale);
+uint8_t qadd8(uint8_t i, uint8_t j);
+uint8_t qsub8(uint8_t i, uint8_t j);
+uint8_t sin8(uint8_t theta);
+
+uint8_t inoise8(uint16_t x);
+
+uint8_t beat8(accum88 beats_per_minute, uint32_t timebase = 0);
+uint8_t beatsin8(accum88 beats_per_minute, uint8_t lowest = 0, uint8_t highest = 255,
+                 uint32_t timebase = 0, uint8_t phase_offset = 0);
+
+#endif // XDRAILS_HOST_FASTLED_H
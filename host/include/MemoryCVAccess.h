@@ -0,0 +1,89 @@
+/**
+ * @file MemoryCVAccess.h
+ * @brief Host-side ICVAccess backed by RAM, including the RCN-227 indexed pages.
+ *
+ * CVs 257-512 are resolved through the page selected by CV31 (high byte) and CV32
+ * (low byte), as on a real decoder. Read and write counters allow tests and benchmarks
+ * to observe how the library accesses its configuration.
+ */
+#ifndef XDRAILS_HOST_MEMORY_CV_ACCESS_H
+#define XDRAILS_HOST_MEMORY_CV_ACCESS_H
+
+#include <cstdint>
+#include <map>
+#include "interfaces/ICVAccess.h"
+
+namespace xDuinoRails {
+
+class MemoryCVAccess : public ICVAccess {
+public:
+    uint8_t readCV(uint16_t cv_number) override {
+        ++_reads;
+        auto it = _values.find(key(cv_number));
+        return (it != _values.end()) ? it->second : 0;
+    }
+
+    void writeCV(uint16_t cv_number, uint8_t value) override {
+        ++_writes;
+        store(key(cv_number), value);
+    }
+
+    /** @brief Block read straight from the page; counts as one block read, not as readCV() calls. */
+    void readCVs(uint16_t page, uint16_t first_cv, uint16_t count, uint8_t* buffer) override {
+        ++_block_reads;
+        for (uint16_t i = 0; i < count; ++i) {
+            uint16_t cv_number = first_cv + i;
+            bool indexed = cv_number >= CV_INDEXED_WINDOW_START && cv_number < CV_INDEXED_WINDOW_START + CV_INDEXED_WINDOW_SIZE;
+            buffer[i] = indexed ? readIndexedCV(page, cv_number) : lookup(cv_number);
+        }
+    }
+
+    /** @brief Writes a CV on an indexed page without going through CV31/CV32. */
+    void writeIndexedCV(uint16_t page, uint16_t cv_number, uint8_t value) {
+        store(((uint32_t)page << 16) | cv_number, value);
+    }
+
+    /** @brief Counts the writes that changed a value; resetCounters() keeps it, like EEPROM would. */
+    uint32_t changeCounter() override { return _changes; }
+
+    /** @brief Reads a CV on an indexed page without going through CV31/CV32. */
+    uint8_t readIndexedCV(uint16_t page, uint16_t cv_number) const {
+        auto it = _values.find(((uint32_t)page << 16) | cv_number);
+        return (it != _values.end()) ? it->second : 0;
+    }
+
+    uint32_t readCount() const { return _reads; }
+    uint32_t writeCount() const { return _writes; }
+    uint32_t blockReadCount() const { return _block_reads; }
+    void resetCounters() { _reads = 0; _writes = 0; _block_reads = 0; }
+
+private:
+    uint32_t key(uint16_t cv_number) const {
+        if (cv_number >= 257 && cv_number <= 512) {
+            uint16_t page = (uint16_t)(lookup(31) << 8) | lookup(32);
+            return ((uint32_t)page << 16) | cv_number;
+        }
+        return cv_number;
+    }
+
+    void store(uint32_t k, uint8_t value) {
+        uint8_t& slot = _values[k];
+        if (slot != value) ++_changes;
+        slot = value;
+    }
+
+    uint8_t lookup(uint16_t cv_number) const {
+        auto it = _values.find(cv_number);
+        return (it != _values.end()) ? it->second : 0;
+    }
+
+    std::map<uint32_t, uint8_t> _values;
+    uint32_t _reads = 0;
+    uint32_t _writes = 0;
+    uint32_t _block_reads = 0;
+    uint32_t _changes = 0;
+};
+
+}
+
+#endif // XDRAILS_HOST_MEMORY_CV_ACCESS_H
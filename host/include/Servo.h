@@ -0,0 +1,24 @@
+/**
+ * @file Servo.h
+ * @brief Host stand-in for the Arduino Servo library, backed by VirtualHardware.
+ */
+#ifndef XDRAILS_HOST_SERVO_H
+#define XDRAILS_HOST_SERVO_H
+
+#include <cstdint>
+
+class Servo {
+public:
+    Servo() {}
+    uint8_t attach(int pin);
+    void detach();
+    void write(int value);
+    int read() const { return _angle; }
+    bool attached() const { return _pin >= 0; }
+
+private:
+    int _pin = -1;
+    int _angle = 90;
+};
+
+#endif // XDRAILS_HOST_SERVO_H
@@ -0,0 +1,125 @@
+/**
+ * @file VirtualHardware.h
+ * @brief Host-side stand-in for the microcontroller: a virtual clock and an I/O event recorder.
+ *
+ * The host versions of Arduino.h, Servo.h, Adafruit_NeoPixel.h and FastLED.h route every
+ * pin, servo and strip access through this module so that output timing can be inspected
+ * off the target.
+ */
+#ifndef XDRAILS_HOST_VIRTUAL_HARDWARE_H
+#define XDRAILS_HOST_VIRTUAL_HARDWARE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace VirtualHardware {
+
+/**
+ * @enum EventType
+ * @brief The kind of hardware access that was recorded.
+ */
+enum class EventType : uint8_t {
+    PIN_MODE,      ///< pinMode(id, value)
+    DIGITAL_WRITE, ///< digitalWrite(id, value)
+    ANALOG_WRITE,  ///< analogWrite(id, value)
+    SERVO_ATTACH,  ///< Servo::attach(id)
+    SERVO_WRITE,   ///< Servo::write(value) on the servo attached to pin id
+    STRIP_SHOW,    ///< Adafruit_NeoPixel::show() on the strip on pin id; value is the pixel count
+};
+
+/**
+ * @struct Event
+ * @brief A single recorded hardware access.
+ */
+struct Event {
+    uint64_t time_us; ///< Virtual time of the access in microseconds.
+    EventType type;   ///< What was accessed.
+    uint16_t id;      ///< The pin number the access refers to.
+    uint32_t value;   ///< The written value (mode, level, angle or pixel count).
+};
+
+/** @brief Clears the event log, all pin states and rewinds the virtual clock to zero. */
+void reset();
+
+/** @brief Enables or disables event recording (pin states are tracked either way). */
+void setRecording(bool enabled);
+
+/** @brief Returns true if events are currently being recorded. */
+bool isRecording();
+
+/** @brief Records an event at the current virtual time. */
+void record(EventType type, uint16_t id, uint32_t value);
+
+/** @brief Returns all events recorded since the last reset() or clearEvents(). */
+const std::vector<Event>& events();
+
+/** @brief Drops all recorded events but keeps the clock and pin states. */
+void clearEvents();
+
+/** @brief Counts recorded events of one type, optionally restricted to one pin (-1 = any). */
+size_t count(EventType type, int id = -1);
+
+/** @brief Returns the current virtual time in microseconds. */
+uint64_t nowMicros();
+
+/** @brief Advances the virtual clock. */
+void advanceMicros(uint64_t us);
+
+/** @brief Advances the virtual clock by whole milliseconds. */
+void advanceMillis(uint32_t ms);
+
+/** @brief Returns the last value written to a pin by digitalWrite/analogWrite. */
+uint32_t pinValue(uint8_t pin);
+
+/** @brief Returns the last mode set for a pin by pinMode. */
+uint8_t modeOf(uint8_t pin);
+
+/**
+ * @brief Total time a pin was HIGH between two virtual times, from the recorded digital writes.
+ *
+ * The pin counts as LOW before its first recorded write, so start recording before it is driven.
+ */
+uint64_t highTimeMicros(uint8_t pin, uint64_t from_us, uint64_t to_us);
+
+/**
+ * @class PortRegister
+ * @brief One 8-bit virtual port register: pins 8n..8n+7 of port n.
+ *
+ * Returned by the host portOutputRegister() and portModeRegister(). Reads compose the pin
+ * states; writes record a DIGITAL_WRITE or PIN_MODE event for every pin whose bit changed.
+ */
+class PortRegister {
+public:
+    PortRegister() = default;
+    PortRegister(uint8_t port, bool mode) : _port(port), _mode(mode) {}
+    operator uint8_t() const;
+    PortRegister& operator=(uint8_t value);
+    PortRegister& operator|=(uint8_t bits) { return *this = (uint8_t)(*this | bits); }
+    PortRegister& operator&=(uint8_t bits) { return *this = (uint8_t)(*this & bits); }
+
+private:
+    uint8_t _port = 0;
+    bool _mode = false;
+};
+
+/** @brief The output (PORTx) register of a virtual port. */
+PortRegister* outputRegister(uint8_t port);
+
+/** @brief The direction (DDRx) register of a virtual port; a set bit is OUTPUT. */
+PortRegister* modeRegister(uint8_t port);
+
+/**
+ * @brief Calls callback every period_us of virtual time, like a periodic timer interrupt.
+ *
+ * There is one timer; attaching again replaces it. advanceMicros() and advanceMillis() run
+ * the callbacks that fall due, with the clock set to each one's time.
+ */
+void attachTimer(uint32_t period_us, void (*callback)());
+
+/** @brief Stops the timer. reset() does this too. */
+void detachTimer();
+
+} // namespace VirtualHardware
+
+#endif // XDRAILS_HOST_VIRTUAL_HARDWARE_H
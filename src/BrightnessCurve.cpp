@@ -0,0 +1,64 @@
+#include "BrightnessCurve.h"
+#include <Arduino.h>
+
+namespace xDuinoRails {
+
+namespace {
+
+struct LevelTable {
+    uint16_t levels[257];
+};
+
+// The table is generated at compile time. The AVR build compiles as C++11, so every constexpr
+// function below is a single return statement.
+
+constexpr double cube(double t) {
+    return t * t * t;
+}
+
+// CIE 1931 relative luminance Y (0..1) of lightness L* (0..100).
+constexpr double cieLuminance(double lightness) {
+    return lightness <= 8.0 ? lightness / 903.3 : cube((lightness + 16.0) / 116.0);
+}
+
+// Relative luminance Y for lightness L* = index / 256 * 100, scaled to 0..0xFFFF.
+constexpr uint16_t cie1931(unsigned index) {
+    return (uint16_t)(cieLuminance(index * 100.0 / 256.0) * 65535.0 + 0.5);
+}
+
+template <unsigned... I> struct Indices {};
+
+template <class A, class B> struct JoinIndices;
+template <unsigned... A, unsigned... B> struct JoinIndices<Indices<A...>, Indices<B...>> {
+    typedef Indices<A..., (sizeof...(A) + B)...> type;
+};
+
+// Indices<0, ..., N - 1>, built by halving so the template depth stays at log2(N).
+template <unsigned N> struct MakeIndices {
+    typedef typename JoinIndices<typename MakeIndices<N / 2>::type, typename MakeIndices<N - N / 2>::type>::type type;
+};
+template <> struct MakeIndices<0> { typedef Indices<> type; };
+template <> struct MakeIndices<1> { typedef Indices<0> type; };
+
+template <unsigned... I>
+constexpr LevelTable makeCie1931Table(Indices<I...>) {
+    return LevelTable{{cie1931(I)...}};
+}
+
+constexpr LevelTable CIE1931_TABLE PROGMEM = makeCie1931Table(MakeIndices<257>::type());
+
+}
+
+uint16_t applyBrightnessCurve(BrightnessCurve curve, uint16_t level) {
+    if (curve != BrightnessCurve::CIE1931 || level == 0) return level;
+    // Stretch 0..0xFFFF to 0..0x10000 so full scale lands exactly on the last entry.
+    uint32_t position = (uint32_t)level + (level >> 15);
+    uint16_t index = position >> 8;
+    uint16_t low = pgm_read_word(&CIE1931_TABLE.levels[index]);
+    if (index == 256) return low;
+    uint16_t high = pgm_read_word(&CIE1931_TABLE.levels[index + 1]);
+    uint16_t value = low + (uint16_t)(((uint32_t)(high - low) * (position & 0xFF)) >> 8);
+    return value > 0 ? value : 1;
+}
+
+}
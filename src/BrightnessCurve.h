@@ -0,0 +1,25 @@
+#ifndef BRIGHTNESSCURVE_H
+#define BRIGHTNESSCURVE_H
+
+#include <cstdint>
+
+namespace xDuinoRails {
+
+/** @brief How PhysicalOutput maps combined effect levels to light source levels. */
+enum class BrightnessCurve : uint8_t {
+    LINEAR,  ///< Levels pass through unchanged (sources that only switch on and off).
+    CIE1931, ///< Perceptually linear: the level is the CIE 1931 lightness L* (the default).
+};
+
+/**
+ * @brief Applies a brightness curve to a 16-bit level.
+ *
+ * The CIE 1931 curve is a 257-entry table generated at compile time and kept in flash
+ * (PROGMEM) on AVR, interpolated linearly between entries. It keeps 0 and 0xFFFF and
+ * maps every other level to at least 1.
+ */
+uint16_t applyBrightnessCurve(BrightnessCurve curve, uint16_t level);
+
+}
+
+#endif // BRIGHTNESSCURVE_H
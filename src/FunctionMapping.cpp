@@ -1,8 +1,66 @@
 #include "FunctionMapping.h"
 #include "xDuinoRails_DccLightsAndFunctions.h"
+#include <algorithm>
 
 namespace xDuinoRails {
 
+void ConditionStateSet::resize(uint16_t count) {
+    _words.assign((count + 31) / 32, 0);
+}
+
+void ConditionStateSet::clear() {
+    std::fill(_words.begin(), _words.end(), 0);
+}
+
+bool ConditionStateSet::allSet(const std::vector<ConditionMask>& masks) const {
+    for (const auto& m : masks) {
+        if ((_words[m.word] & m.bits) != m.bits) return false;
+    }
+    return true;
+}
+
+bool ConditionStateSet::noneSet(const std::vector<ConditionMask>& masks) const {
+    for (const auto& m : masks) {
+        if (_words[m.word] & m.bits) return false;
+    }
+    return true;
+}
+
+std::vector<ConditionMask> ConditionStateSet::makeMasks(std::vector<uint16_t> indices) {
+    std::sort(indices.begin(), indices.end());
+    std::vector<ConditionMask> masks;
+    for (uint16_t index : indices) {
+        uint16_t word = index >> 5;
+        uint32_t bit = (uint32_t)1 << (index & 31);
+        if (!masks.empty() && masks.back().word == word) {
+            masks.back().bits |= bit;
+        } else {
+            masks.push_back({word, bit});
+        }
+    }
+    return masks;
+}
+
+bool ConditionVariable::samePredicate(const ConditionVariable& other) const {
+    if (conditions.size() != other.conditions.size()) return false;
+    for (size_t i = 0; i < conditions.size(); ++i) {
+        const Condition& a = conditions[i];
+        const Condition& b = other.conditions[i];
+        if (a.source != b.source || a.comparator != b.comparator || a.parameter != b.parameter) return false;
+    }
+    return true;
+}
+
+uint32_t ConditionVariable::predicateHash() const {
+    uint32_t hash = 2166136261u; // FNV-1a
+    for (const auto& cond : conditions) {
+        for (uint8_t byte : {(uint8_t)cond.source, (uint8_t)cond.comparator, cond.parameter}) {
+            hash = (hash ^ byte) * 16777619u;
+        }
+    }
+    return hash;
+}
+
 bool ConditionVariable::evaluate(const AuxController& controller) const {
     for (const auto& cond : conditions) {
         bool result = false;
@@ -32,14 +90,75 @@ bool ConditionVariable::evaluate(const AuxController& controller) const {
     return true;
 }
 
-bool MappingRule::evaluate(const AuxController& controller) const {
-    for (uint16_t id : positive_conditions) {
-        if (!controller.getConditionVariableState(id)) return false;
+bool MappingRule::evaluate(const ConditionStateSet& states) const {
+    return states.allSet(positive_mask) && states.noneSet(negative_mask);
+}
+
+uint16_t DependencyIndex::makeInputKey(TriggerSource source, uint8_t parameter) {
+    if (source == TriggerSource::DIRECTION || source == TriggerSource::SPEED) parameter = 0;
+    return ((uint16_t)source << 8) | parameter;
+}
+
+uint16_t DependencyIndex::makeInputKey(const Condition& condition) {
+    return makeInputKey(condition.source, condition.parameter);
+}
+
+void DependencyIndex::clear() {
+    input_keys.clear();
+    input_offsets.clear();
+    input_conditions.clear();
+    condition_offsets.clear();
+    condition_rules.clear();
+}
+
+void DependencyIndex::build(const std::vector<ConditionVariable>& conditions, const std::vector<MappingRule>& rules) {
+    clear();
+
+    std::vector<std::pair<uint16_t, uint16_t>> edges; // (input key, condition index)
+    for (uint16_t i = 0; i < conditions.size(); ++i) {
+        for (const auto& cond : conditions[i].conditions) {
+            edges.push_back(std::make_pair(makeInputKey(cond), i));
+        }
     }
-    for (uint16_t id : negative_conditions) {
-        if (controller.getConditionVariableState(id)) return false;
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    for (const auto& edge : edges) {
+        if (input_keys.empty() || input_keys.back() != edge.first) {
+            input_keys.push_back(edge.first);
+            input_offsets.push_back((uint16_t)input_conditions.size());
+        }
+        input_conditions.push_back(edge.second);
     }
-    return true;
+    input_offsets.push_back((uint16_t)input_conditions.size());
+
+    edges.clear(); // (condition index, rule index)
+    for (uint16_t r = 0; r < rules.size(); ++r) {
+        for (const auto* masks : {&rules[r].positive_mask, &rules[r].negative_mask}) {
+            for (const auto& m : *masks) {
+                for (uint8_t bit = 0; bit < 32; ++bit) {
+                    uint16_t index = (uint16_t)(m.word * 32 + bit);
+                    if (((m.bits >> bit) & 1) && index < conditions.size()) {
+                        edges.push_back(std::make_pair(index, r));
+                    }
+                }
+            }
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    condition_offsets.assign(conditions.size() + 1, 0);
+    for (const auto& edge : edges) {
+        ++condition_offsets[edge.first + 1];
+        condition_rules.push_back(edge.second);
+    }
+    for (size_t i = 1; i < condition_offsets.size(); ++i) {
+        condition_offsets[i] += condition_offsets[i - 1];
+    }
+}
+
+int DependencyIndex::findInput(uint16_t key) const {
+    auto it = std::lower_bound(input_keys.begin(), input_keys.end(), key);
+    return (it != input_keys.end() && *it == key) ? (int)(it - input_keys.begin()) : -1;
 }
 
 }
@@ -29,11 +29,24 @@ enum class TriggerComparator : uint8_t {
     IS_TRUE = 8,
 };
 
+/**
+ * @brief What a MappingRule does to its logical function.
+ *
+ * The level actions hold while the rule is true: a logical function is active while any
+ * ACTIVATE rule or mask term is true and no DEACTIVATE rule is, and dimmed while any
+ * SET_DIMMED rule is. The toggle actions fire once when the rule becomes true.
+ *
+ * No CV mapping method produces the toggle actions (RCN-225 and RCN-227 only describe levels).
+ * They exist only for rules built by hand with AuxController::addMappingRule(), which is
+ * internal API (public under UNIT_TEST).
+ */
 enum class MappingAction : uint8_t {
     NONE = 0,
     ACTIVATE = 1,
     DEACTIVATE = 2,
     SET_DIMMED = 3,
+    TOGGLE_ACTIVE = 4,
+    TOGGLE_DIMMED = 5,
 };
 
 enum class FunctionMappingMethod : uint8_t {
@@ -45,6 +58,43 @@ enum class FunctionMappingMethod : uint8_t {
     RCN_227_PER_OUTPUT_V3 = 5,
 };
 
+/**
+ * @brief One 32-bit word of a packed condition bitset and the bits of interest in it.
+ */
+struct ConditionMask {
+    uint16_t word;
+    uint32_t bits;
+};
+
+/**
+ * @brief Packed bitset holding the evaluated state of every ConditionVariable.
+ *
+ * ConditionVariables are addressed by their dense index (their position after loading),
+ * not by their sparse id.
+ */
+class ConditionStateSet {
+public:
+    void resize(uint16_t count);
+    void clear();
+    bool test(uint16_t index) const {
+        return (_words[index >> 5] >> (index & 31)) & 1;
+    }
+    void set(uint16_t index, bool value) {
+        uint32_t bit = (uint32_t)1 << (index & 31);
+        if (value) _words[index >> 5] |= bit; else _words[index >> 5] &= ~bit;
+    }
+    /** @brief True if every bit selected by the masks is set. */
+    bool allSet(const std::vector<ConditionMask>& masks) const;
+    /** @brief True if no bit selected by the masks is set. */
+    bool noneSet(const std::vector<ConditionMask>& masks) const;
+
+    /** @brief Builds the word masks selecting the given dense indices. */
+    static std::vector<ConditionMask> makeMasks(std::vector<uint16_t> indices);
+
+private:
+    std::vector<uint32_t> _words;
+};
+
 struct Condition {
     TriggerSource source;
     TriggerComparator comparator;
@@ -55,14 +105,76 @@ struct ConditionVariable {
     uint16_t id;
     std::vector<Condition> conditions;
     bool evaluate(const AuxController& controller) const;
+    /** @brief True if both variables test the same conditions in the same order; ids are ignored. */
+    bool samePredicate(const ConditionVariable& other) const;
+    /** @brief Hash of the conditions, equal for variables with the same predicate. */
+    uint32_t predicateHash() const;
 };
 
 struct MappingRule {
     uint8_t target_logical_function_id;
-    std::vector<uint16_t> positive_conditions;
-    std::vector<uint16_t> negative_conditions;
+    std::vector<uint16_t> positive_conditions; ///< ConditionVariable ids, consumed when the mapping is compiled.
+    std::vector<uint16_t> negative_conditions; ///< ConditionVariable ids, consumed when the mapping is compiled.
+    std::vector<ConditionMask> positive_mask;  ///< Compiled form of positive_conditions.
+    std::vector<ConditionMask> negative_mask;  ///< Compiled form of negative_conditions.
     MappingAction action;
-    bool evaluate(const AuxController& controller) const;
+    bool evaluate(const ConditionStateSet& states) const;
+};
+
+/**
+ * @brief Compiled activation term of the bitmask-based mapping methods (RCN-225, RCN-227
+ * per-function and per-output V1).
+ *
+ * The term keeps the function masks of the CVs instead of expanding every set bit into a
+ * ConditionVariable. It is true when (function_bits & function_mask[direction]) != 0 and
+ * (function_bits & blocking_mask) == 0.
+ */
+struct FunctionMaskTerm {
+    uint8_t target_logical_function_id;
+    uint32_t function_mask[2]; ///< Activating functions, indexed by DecoderDirection.
+    uint32_t blocking_mask;    ///< Functions that block the term in either direction.
+    bool evaluate(uint32_t function_bits, uint8_t direction) const {
+        return (function_bits & function_mask[direction & 1]) != 0 && (function_bits & blocking_mask) == 0;
+    }
+    /** @brief All functions the term reads. */
+    uint32_t inputs() const { return function_mask[0] | function_mask[1] | blocking_mask; }
+};
+
+/**
+ * @brief Number of true level rules and terms targeting one logical function.
+ *
+ * Kept up to date as rules change, so the desired state of a logical function is known
+ * without walking its rules.
+ */
+struct LogicalFunctionLevel {
+    uint16_t activations = 0; ///< True ACTIVATE rules and mask terms.
+    uint16_t blocks = 0;      ///< True DEACTIVATE rules.
+    uint16_t dims = 0;        ///< True SET_DIMMED rules.
+    bool drives_active = false; ///< Has ACTIVATE rules or mask terms; otherwise only toggles set the state.
+    bool drives_dimmed = false; ///< Has SET_DIMMED rules.
+};
+
+/**
+ * @brief Reverse index from decoder inputs to the ConditionVariables and MappingRules that read them.
+ *
+ * An input is a TriggerSource together with its parameter (function number, binary state
+ * number or logical function index); direction and speed are single inputs. Both tables are
+ * stored as offset arrays over flat index lists so lookups do not allocate.
+ */
+struct DependencyIndex {
+    static uint16_t makeInputKey(TriggerSource source, uint8_t parameter);
+    static uint16_t makeInputKey(const Condition& condition);
+
+    void build(const std::vector<ConditionVariable>& conditions, const std::vector<MappingRule>& rules);
+    void clear();
+    /** @brief Returns the slot of an input, or -1 if nothing depends on it. */
+    int findInput(uint16_t key) const;
+
+    std::vector<uint16_t> input_keys;          ///< Sorted input keys, one per slot.
+    std::vector<uint16_t> input_offsets;       ///< input_conditions range of each slot (size slots + 1).
+    std::vector<uint16_t> input_conditions;    ///< Dense condition indices.
+    std::vector<uint16_t> condition_offsets;   ///< condition_rules range of each condition (size conditions + 1).
+    std::vector<uint16_t> condition_rules;     ///< Rule indices.
 };
 
 }
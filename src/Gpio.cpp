@@ -0,0 +1,53 @@
+#include "Gpio.h"
+
+namespace xDuinoRails {
+
+GpioMask GpioPort::begin(uint8_t pin) {
+#ifdef XDRAILS_GPIO_PORTS
+    _out = portOutputRegister(digitalPinToPort(pin));
+    _mode = portModeRegister(digitalPinToPort(pin));
+    return digitalPinToBitMask(pin);
+#else
+    _pin = pin;
+    return 1;
+#endif
+}
+
+bool GpioPort::samePort(const GpioPort& other) const {
+#ifdef XDRAILS_GPIO_PORTS
+    return _out == other._out;
+#else
+    return _pin == other._pin;
+#endif
+}
+
+void GpioPort::setDirection(GpioMask managed, GpioMask outputs) const {
+#ifdef XDRAILS_GPIO_PORTS
+    *_mode = (GpioMask)((*_mode & (GpioMask)~managed) | (outputs & managed));
+#else
+    if (managed) pinMode(_pin, outputs ? OUTPUT : INPUT);
+#endif
+}
+
+void GpioPort::write(GpioMask managed, GpioMask high) const {
+#ifdef XDRAILS_GPIO_PORTS
+    *_out = (GpioMask)((*_out & (GpioMask)~managed) | (high & managed));
+#else
+    if (managed) digitalWrite(_pin, high ? HIGH : LOW);
+#endif
+}
+
+void GpioPin::begin(uint8_t pin) {
+    _pin = pin;
+    _mask = _port.begin(pin);
+    pinMode(pin, OUTPUT);
+    write(false);
+}
+
+void GpioPin::write(bool high) {
+    noInterrupts(); // The tick interrupt may write the same port
+    _port.write(_mask, high ? _mask : 0);
+    interrupts();
+}
+
+}
@@ -0,0 +1,63 @@
+#ifndef GPIO_H
+#define GPIO_H
+
+#include <Arduino.h>
+#include <cstdint>
+
+namespace xDuinoRails {
+
+#ifdef portOutputRegister
+/** @brief The core exposes port registers: pins are written through a register and mask. */
+#define XDRAILS_GPIO_PORTS 1
+typedef decltype(portOutputRegister(0)) GpioRegister;
+typedef decltype(digitalPinToBitMask(0)) GpioMask;
+#else
+typedef uint8_t GpioMask;
+#endif
+
+/**
+ * @brief The direction and output registers of one GPIO port, resolved once.
+ *
+ * On cores without port registers a port is a single pin with mask 1, driven through
+ * pinMode() and digitalWrite(). The writes are not atomic; outside the tick interrupt,
+ * use GpioPin or disable interrupts around them.
+ */
+class GpioPort {
+public:
+    /** @brief Resolves the port of a pin and returns the pin's mask in it. */
+    GpioMask begin(uint8_t pin);
+    bool samePort(const GpioPort& other) const;
+    /** @brief Makes the set bits of `outputs` outputs and the other `managed` pins inputs. */
+    void setDirection(GpioMask managed, GpioMask outputs) const;
+    /** @brief Drives the set bits of `high` HIGH and the other `managed` pins LOW. */
+    void write(GpioMask managed, GpioMask high) const;
+
+private:
+#ifdef XDRAILS_GPIO_PORTS
+    GpioRegister _out = nullptr;
+    GpioRegister _mode = nullptr;
+#else
+    uint8_t _pin = 0;
+#endif
+};
+
+/** @brief An output pin resolved once to its port and mask. */
+class GpioPin {
+public:
+    /** @brief Resolves the pin and makes it an output, driven LOW. */
+    void begin(uint8_t pin);
+    /** @brief Drives the pin; safe against the tick interrupt writing the same port. */
+    void write(bool high);
+    uint8_t pin() const { return _pin; }
+    const GpioPort& port() const { return _port; }
+    GpioMask mask() const { return _mask; }
+
+private:
+    GpioPort _port;
+    GpioMask _mask = 0;
+    uint8_t _pin = 0;
+};
+
+}
+
+#endif // GPIO_H
@@ -2,75 +2,143 @@
 
 namespace xDuinoRails {
 
-CharlieplexedLeds::CharlieplexedLeds(const std::vector<uint8_t>& pins) : _pins(pins) {
-    _ledStates.resize(_pins.size() * (_pins.size() - 1), false);
+CharlieplexedLeds::CharlieplexedLeds(SoftPwm& ticks, const std::vector<uint8_t>& pins, uint8_t depth_bits) :
+    _ticks(ticks),
+    _pins(pins),
+    _depth(depth_bits >= 1 && depth_bits <= 8 ? depth_bits : 5)
+{
+    _levels.resize(_pins.size() * (_pins.size() - 1), 255);
+}
+
+CharlieplexedLeds::CharlieplexedLeds(const std::vector<uint8_t>& pins, uint8_t depth_bits) :
+    _own_ticks(new SoftPwm()),
+    _ticks(*_own_ticks),
+    _pins(pins),
+    _depth(depth_bits >= 1 && depth_bits <= 8 ? depth_bits : 5)
+{
+    _levels.resize(_pins.size() * (_pins.size() - 1), 255);
+}
+
+CharlieplexedLeds::~CharlieplexedLeds() {
+    if (_begun) _ticks.removeListener(this);
 }
 
 void CharlieplexedLeds::begin() {
-    // All pins to INPUT to effectively disconnect them
+    if (_begun) return;
+    _begun = true;
+    // Resolve the pins to ports once; all start as INPUT to effectively disconnect them.
     for (uint8_t pin : _pins) {
+        GpioPort port;
+        GpioMask mask = port.begin(pin);
+        uint8_t index = 0;
+        while (index < _ports.size() && !_ports[index].port.samePort(port)) ++index;
+        if (index == _ports.size()) _ports.push_back({port, 0});
+        _ports[index].pins |= mask;
+        _pin_ports.push_back(index);
+        _pin_masks.push_back(mask);
         pinMode(pin, INPUT);
     }
+    size_t patterns = _pins.size() * _depth * _ports.size();
+    _frames[0].assign(patterns, Pattern{0, 0});
+    _frames[1].assign(patterns, Pattern{0, 0});
+    _shown.assign(_ports.size(), Pattern{0, 0});
+    _ticks.addListener(this);
+    _ticks.begin();
 }
 
 void CharlieplexedLeds::on() {
-    for (size_t i = 0; i < _ledStates.size(); ++i) {
-        _ledStates[i] = true;
-    }
+    setLevel(_on_level);
 }
 
 void CharlieplexedLeds::off() {
-    for (size_t i = 0; i < _ledStates.size(); ++i) {
-        _ledStates[i] = false;
-    }
+    _output_level = 0;
+    _dirty = true;
 }
 
 void CharlieplexedLeds::setLevel(uint8_t level) {
-    // Charlieplexing doesn't really support brightness levels in a simple way.
-    // We'll just turn them on or off.
-    if (level > 0) {
-        on();
-    } else {
-        off();
-    }
+    if (level > 0) _on_level = level;
+    _output_level = level;
+    _dirty = true;
 }
 
 void CharlieplexedLeds::setLed(uint8_t led, bool state) {
-    if (led < _ledStates.size()) {
-        _ledStates[led] = state;
+    setLedLevel(led, state ? 255 : 0);
+}
+
+void CharlieplexedLeds::setLedLevel(uint8_t led, uint8_t level) {
+    if (led < _levels.size()) {
+        _levels[led] = level;
+        _dirty = true;
     }
 }
 
 void CharlieplexedLeds::update(uint32_t delta_ms) {
-    _lastUpdateTime += delta_ms;
-    if (_lastUpdateTime < 1) {
-        return;
+    // No-op: the tick scans the LEDs
+}
+
+void CharlieplexedLeds::buildFrame(std::vector<Pattern>& frame) const {
+    uint8_t per_row = (uint8_t)(_pins.size() - 1);
+    uint16_t full = (uint16_t)((1 << _depth) - 1);
+    size_t ports = _ports.size();
+    for (auto& pattern : frame) pattern = Pattern{0, 0};
+    for (uint8_t row = 0; row < _pins.size(); ++row) {
+        for (uint8_t k = 0; k < per_row; ++k) {
+            uint16_t level = (uint16_t)_levels[row * per_row + k] * _output_level / 255;
+            uint16_t steps = (uint16_t)((level * full + 127) / 255);
+            if (level > 0 && steps == 0) steps = 1; // A lit LED never rounds to off
+            uint8_t cathode = k >= row ? k + 1 : k;
+            for (uint8_t bit = 0; bit < _depth; ++bit) {
+                if (!(steps & (1 << bit))) continue;
+                Pattern* patterns = &frame[(row * _depth + bit) * ports];
+                patterns[_pin_ports[cathode]].outputs |= _pin_masks[cathode];
+                patterns[_pin_ports[row]].outputs |= _pin_masks[row];
+                patterns[_pin_ports[row]].high |= _pin_masks[row];
+            }
+        }
     }
-    _lastUpdateTime = 0;
+}
 
-    // Turn off the current LED
-    uint8_t anode = _currentLed / (_pins.size() - 1);
-    uint8_t cathode = _currentLed % (_pins.size() - 1);
-    if (cathode >= anode) {
-        cathode++;
+void CharlieplexedLeds::commit() {
+    if (!_dirty || !_begun) return;
+    _dirty = false;
+    // While no swap is pending the scan only reads the front buffer, so the back one is free.
+    _swap_pending = false;
+    XDRAILS_TICK_BARRIER(); // Keep the frame stores after the flag is cleared...
+    buildFrame(_frames[_front ^ 1]);
+    XDRAILS_TICK_BARRIER(); // ...and before it is set again
+    _swap_pending = true;
+}
+
+void CharlieplexedLeds::show(const Pattern* patterns) {
+    bool same = true;
+    for (size_t i = 0; i < _ports.size(); ++i) {
+        same = same && patterns[i].outputs == _shown[i].outputs && patterns[i].high == _shown[i].high;
     }
-    pinMode(_pins[anode], INPUT);
-    pinMode(_pins[cathode], INPUT);
-
-    // Move to the next LED
-    _currentLed = (_currentLed + 1) % _ledStates.size();
-
-    // Turn on the next LED if it's supposed to be on
-    if (_ledStates[_currentLed]) {
-        anode = _currentLed / (_pins.size() - 1);
-        cathode = _currentLed % (_pins.size() - 1);
-        if (cathode >= anode) {
-            cathode++;
-        }
-        pinMode(_pins[anode], OUTPUT);
-        digitalWrite(_pins[anode], HIGH);
-        pinMode(_pins[cathode], OUTPUT);
-        digitalWrite(_pins[cathode], LOW);
+    if (same) return;
+    // Release every pin before driving the new pattern, so no LED lights in between.
+    for (auto& port : _ports) port.port.setDirection(port.pins, 0);
+    for (size_t i = 0; i < _ports.size(); ++i) {
+        _ports[i].port.write(_ports[i].pins, patterns[i].high);
+        _ports[i].port.setDirection(_ports[i].pins, patterns[i].outputs);
+        _shown[i] = patterns[i];
+    }
+}
+
+void CharlieplexedLeds::onTick() {
+    if (_tick == 0 && _row == 0 && _swap_pending) {
+        XDRAILS_TICK_BARRIER(); // Read the frame only after seeing it published
+        _front ^= 1;
+        _swap_pending = false;
+    }
+    // Bit b of the row starts at tick 2^b - 1 of its sub-frame.
+    if ((_tick & (_tick + 1)) == 0) {
+        show(&_frames[_front][(_row * _depth + _plane) * _ports.size()]);
+        ++_plane;
+    }
+    if (++_tick == (1 << _depth) - 1) {
+        _tick = 0;
+        _plane = 0;
+        if (++_row == _pins.size()) _row = 0;
     }
 }
 
@@ -2,29 +2,92 @@
 #define CHARLIEPLEXEDLEDS_H
 
 #include "LightSource.h"
+#include "../Gpio.h"
+#include "../SoftPwm.h"
 #include <Arduino.h>
+#include <memory>
 #include <vector>
 
 namespace xDuinoRails {
 
-class CharlieplexedLeds : public LightSource {
+/**
+ * @brief Up to n * (n - 1) LEDs charlieplexed on n pins, each with its own level.
+ *
+ * The LEDs are scanned from SoftPwm's timer tick, one anode pin (row) at a time, so the
+ * refresh rate does not depend on how often the main loop runs. Each row is shown for a
+ * bit-angle-modulated sub-frame of 2^depth_bits - 1 ticks: 5 pins at the default 5 bits
+ * and 32 us ticks refresh at 200 Hz.
+ *
+ * LED i has pin i / (n - 1) as anode and the (i % (n - 1))-th of the other pins as cathode.
+ * Frames hold the direction and output register values of every port for each row and bit,
+ * so a scan step is a few register writes.
+ * Level changes are staged; commit() publishes them as a new frame, which the scan picks up
+ * at its next start, so it never shows a half-written frame. The SoftPwm must outlive it.
+ *
+ * Every LED starts at full level, so an output driven by a mapping lights all of them, as
+ * on()/setLevel() always did; setLed()/setLedLevel() pick individual ones.
+ */
+class CharlieplexedLeds : public LightSource, public TickListener {
 public:
-    CharlieplexedLeds(const std::vector<uint8_t>& pins);
+    CharlieplexedLeds(SoftPwm& ticks, const std::vector<uint8_t>& pins, uint8_t depth_bits = 5);
+    /**
+     * @brief Scans from a SoftPwm of its own. Only one SoftPwm can own the tick timer, so
+     * sketches that also dim other pins by software PWM should pass theirs instead.
+     */
+    explicit CharlieplexedLeds(const std::vector<uint8_t>& pins, uint8_t depth_bits = 5);
+    ~CharlieplexedLeds();
 
     void begin() override;
     void on() override;
     void off() override;
+    /** @brief Scales the level of every LED (the output's level). */
     void setLevel(uint8_t level) override;
     void update(uint32_t delta_ms) override;
+    void commit() override;
+    void onTick() override;
 
     void setLed(uint8_t led, bool state);
+    void setLedLevel(uint8_t led, uint8_t level);
+    uint16_t ledCount() const { return (uint16_t)_levels.size(); }
 
 private:
+    struct Port {
+        GpioPort port;
+        GpioMask pins; // The LED pins on this port
+    };
+    struct Pattern {
+        GpioMask outputs; // Direction: the anode and the lit cathodes
+        GpioMask high;    // Output: the anode
+    };
 
+    void buildFrame(std::vector<Pattern>& frame) const;
+    void show(const Pattern* patterns);
+
+    std::unique_ptr<SoftPwm> _own_ticks; // Set by the constructor without a SoftPwm
+    SoftPwm& _ticks;
     std::vector<uint8_t> _pins;
-    std::vector<bool> _ledStates;
-    uint8_t _currentLed = 0;
-    uint32_t _lastUpdateTime = 0;
+    std::vector<uint8_t> _levels; // Per LED
+    uint8_t _depth;
+    uint8_t _output_level = 0;
+    uint8_t _on_level = 255; // Restored by on()
+    bool _dirty = false;
+    bool _begun = false;
+
+    std::vector<Port> _ports;
+    std::vector<uint8_t> _pin_ports;  // Index into _ports, per pin
+    std::vector<GpioMask> _pin_masks; // Mask in that port, per pin
+
+    // Patterns per row, bit and port, [(row * depth + bit) * ports + port]; the scan reads
+    // _frames[_front]. _shown holds the patterns on the pins now.
+    std::vector<Pattern> _frames[2];
+    std::vector<Pattern> _shown;
+    volatile uint8_t _front = 0;
+    volatile bool _swap_pending = false;
+
+    // Scan state, owned by onTick().
+    uint8_t _row = 0;
+    uint8_t _tick = 0;
+    uint8_t _plane = 0;
 };
 
 }
@@ -4,50 +4,115 @@ namespace xDuinoRails {
 
 DualColorLed::DualColorLed(uint8_t pin1, uint8_t pin2) : _pin1(pin1), _pin2(pin2) {}
 
+DualColorLed::DualColorLed(SoftPwm& ticks, uint8_t pin1, uint8_t pin2) : _ticks(&ticks), _pin1(pin1), _pin2(pin2) {}
+
+DualColorLed::~DualColorLed() {
+    if (_ticks && _begun) _ticks->removeListener(this);
+}
+
 void DualColorLed::begin() {
-    pinMode(_pin1, OUTPUT);
-    pinMode(_pin2, OUTPUT);
-    off();
+    if (_begun) return;
+    _begun = true;
+    _gpio1.begin(_pin1);
+    _gpio2.begin(_pin2);
+    _state = DualColorLedState::Off;
+    if (_ticks) {
+        _ticks->addListener(this);
+        _ticks->begin();
+    }
 }
 
 void DualColorLed::on() {
-    setColor(DualColorLedState::Color1);
+    setLevel(_on_level);
 }
 
 void DualColorLed::off() {
-    digitalWrite(_pin1, LOW);
-    digitalWrite(_pin2, LOW);
-    _state = DualColorLedState::Off;
+    setLevel(0);
 }
 
 void DualColorLed::setLevel(uint8_t level) {
-    if (level > 0) {
-        on();
+    if (level > 0) _on_level = level;
+    _level = level;
+    if (_ticks) {
+        _dirty = true;
+    } else if (level == 0) {
+        setColor(DualColorLedState::Off);
     } else {
-        off();
+        setColor(_mix < 128 ? DualColorLedState::Color1 : DualColorLedState::Color2);
     }
 }
 
 void DualColorLed::setColor(DualColorLedState color) {
     _state = color;
-    switch (_state) {
-        case DualColorLedState::Off:
-            digitalWrite(_pin1, LOW);
-            digitalWrite(_pin2, LOW);
-            break;
-        case DualColorLedState::Color1:
-            digitalWrite(_pin1, HIGH);
-            digitalWrite(_pin2, LOW);
-            break;
-        case DualColorLedState::Color2:
-            digitalWrite(_pin1, LOW);
-            digitalWrite(_pin2, HIGH);
-            break;
+    if (_ticks) {
+        // Pick the colour's end of the mix; Off keeps the mix for the next on().
+        if (color == DualColorLedState::Off) {
+            _level = 0;
+        } else {
+            _mix = color == DualColorLedState::Color1 ? 0 : 255;
+            _level = _on_level;
+        }
+        _dirty = true;
+        return;
+    }
+    // Release the lit pin first, so both are never driven HIGH at once.
+    if (color != DualColorLedState::Color1) _gpio1.write(false);
+    if (color != DualColorLedState::Color2) _gpio2.write(false);
+    if (color == DualColorLedState::Color1) _gpio1.write(true);
+    if (color == DualColorLedState::Color2) _gpio2.write(true);
+}
+
+void DualColorLed::setColorMix(uint8_t mix) {
+    _mix = mix;
+    if (_ticks) {
+        _dirty = true;
+    } else if (_level > 0) {
+        setColor(_mix < 128 ? DualColorLedState::Color1 : DualColorLedState::Color2);
     }
 }
 
 void DualColorLed::update(uint32_t delta_ms) {
-    // No-op
+    // No-op: the tick mixes the colours
+}
+
+void DualColorLed::commit() {
+    if (!_dirty) return;
+    _dirty = false;
+    uint8_t ticks2 = (uint8_t)((uint16_t)_level * _mix / 255);
+    // The tick only latches while _pending is set, so it never sees half of an update.
+    _pending = false;
+    XDRAILS_TICK_BARRIER(); // Stage only after the flag is cleared...
+    _next_ticks1 = (uint8_t)(_level - ticks2);
+    _next_ticks2 = ticks2;
+    XDRAILS_TICK_BARRIER(); // ...and publish only after both are staged
+    _pending = true;
+}
+
+void DualColorLed::show(DualColorLedState state) const {
+    // As in setColor(), without the interrupt locking GpioPin::write() needs outside the tick.
+    bool high1 = state == DualColorLedState::Color1;
+    bool high2 = state == DualColorLedState::Color2;
+    if (!high1) _gpio1.port().write(_gpio1.mask(), 0);
+    if (!high2) _gpio2.port().write(_gpio2.mask(), 0);
+    if (high1) _gpio1.port().write(_gpio1.mask(), _gpio1.mask());
+    if (high2) _gpio2.port().write(_gpio2.mask(), _gpio2.mask());
+}
+
+void DualColorLed::onTick() {
+    if (_tick == 0 && _pending) {
+        XDRAILS_TICK_BARRIER(); // Read the staged values only after seeing them published
+        _ticks1 = _next_ticks1;
+        _ticks2 = _next_ticks2;
+        _pending = false;
+    }
+    DualColorLedState state = DualColorLedState::Off;
+    if (_tick < _ticks1) state = DualColorLedState::Color1;
+    else if (_tick - _ticks1 < _ticks2) state = DualColorLedState::Color2;
+    if (state != _shown) {
+        show(state);
+        _shown = state;
+    }
+    if (++_tick == 255) _tick = 0;
 }
 
 }
@@ -2,6 +2,8 @@
 #define DUALCOLORLED_H
 
 #include "LightSource.h"
+#include "../Gpio.h"
+#include "../SoftPwm.h"
 #include <Arduino.h>
 
 namespace xDuinoRails {
@@ -12,22 +14,63 @@ enum class DualColorLedState {
     Color2
 };
 
-class DualColorLed : public LightSource {
+/**
+ * @brief A two-pin bicolour LED (two LEDs in anti-parallel): pin1 HIGH shows colour 1,
+ * pin2 HIGH colour 2.
+ *
+ * Constructed with a SoftPwm, the LED mixes and dims from the PWM tick. Each 255-tick
+ * frame shows colour 1, then colour 2, for their share of the level (see setColorMix()).
+ * Without one it only switches between Off, Color1 and Color2.
+ */
+class DualColorLed : public LightSource, public TickListener {
 public:
     DualColorLed(uint8_t pin1, uint8_t pin2);
+    DualColorLed(SoftPwm& ticks, uint8_t pin1, uint8_t pin2);
+    ~DualColorLed();
 
     void begin() override;
     void on() override;
     void off() override;
     void setLevel(uint8_t level) override;
     void update(uint32_t delta_ms) override;
+    void commit() override;
+    void onTick() override;
+    BrightnessCurve brightnessCurve() const override {
+        return _ticks ? BrightnessCurve::CIE1931 : BrightnessCurve::LINEAR;
+    }
 
     void setColor(DualColorLedState color);
+    /**
+     * @brief Sets the hue: 0 is all colour 1, 255 all colour 2, in between a mix.
+     *
+     * Without a SoftPwm the LED shows the dominant colour.
+     */
+    void setColorMix(uint8_t mix);
 
 private:
+    void show(DualColorLedState state) const;
+
+    SoftPwm* _ticks = nullptr;
     uint8_t _pin1;
     uint8_t _pin2;
+    GpioPin _gpio1;
+    GpioPin _gpio2;
     DualColorLedState _state = DualColorLedState::Off;
+    uint8_t _level = 0;
+    uint8_t _on_level = 255; // Restored by on()
+    uint8_t _mix = 0;
+    bool _dirty = false;
+    bool _begun = false;
+
+    // Ticks of colour 1 and colour 2 per frame. commit() stages them in _next_* and the tick
+    // latches them at the start of a frame.
+    uint8_t _next_ticks1 = 0;
+    uint8_t _next_ticks2 = 0;
+    volatile bool _pending = false;
+    uint8_t _ticks1 = 0;
+    uint8_t _ticks2 = 0;
+    uint8_t _tick = 0;
+    DualColorLedState _shown = DualColorLedState::Off;
 };
 
 }
@@ -2,6 +2,8 @@
 #define LIGHTSOURCE_H
 
 #include <cstdint>
+#include "../BrightnessCurve.h"
+#include "../Scheduling.h"
 
 namespace xDuinoRails {
 
@@ -13,7 +15,36 @@ public:
     virtual void on() = 0;
     virtual void off() = 0;
     virtual void setLevel(uint8_t level) = 0;
+    /**
+     * @brief Sets a 16-bit level, for sources with finer than 8-bit resolution.
+     *
+     * PhysicalOutput only calls this if hasFineLevels() is true; other sources get setLevel()
+     * with the level dithered to 8 bits from frame to frame.
+     */
+    virtual void setLevel16(uint16_t level) { setLevel((uint8_t)(level >> 8)); }
+    virtual bool hasFineLevels() const { return false; }
     virtual void update(uint32_t delta_ms) = 0;
+    /**
+     * @brief Milliseconds until update() must run again, or UPDATE_IDLE if it does nothing.
+     *
+     * PhysicalOutput skips update() on idle sources, so only sources that refresh on their
+     * own (e.g. multiplexing) need to override this.
+     */
+    virtual uint32_t nextUpdateMs() const { return UPDATE_IDLE; }
+    /**
+     * @brief Transmits buffered changes to the hardware.
+     *
+     * Sources that drive a shared bus (e.g. a NeoPixel strip) only buffer on(), off() and
+     * setLevel() and send the frame here. AuxController::update() calls it once per update,
+     * after all effects have written their values.
+     */
+    virtual void commit() {}
+    /**
+     * @brief The curve PhysicalOutput applies to levels before setLevel(), by default CIE 1931.
+     *
+     * Sources that only switch on and off return BrightnessCurve::LINEAR.
+     */
+    virtual BrightnessCurve brightnessCurve() const { return BrightnessCurve::CIE1931; }
 };
 
 }
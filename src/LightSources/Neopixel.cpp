@@ -36,11 +36,18 @@ void Neopixel::setLevel(uint8_t level) {
 
         _strip.setPixelColor(0, _strip.Color(r, g, b));
     }
-    _strip.show();
+    _dirty = true;
 }
 
 void Neopixel::update(uint32_t delta_ms) {
     // No-op
 }
 
+void Neopixel::commit() {
+    if (_dirty) {
+        _strip.show();
+        _dirty = false;
+    }
+}
+
 }
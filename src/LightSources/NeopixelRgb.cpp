@@ -15,21 +15,28 @@ void NeopixelRgb::begin() {
 
 void NeopixelRgb::on() {
     _strip.setPixelColor(0, _color);
-    _strip.show();
+    _dirty = true;
 }
 
 void NeopixelRgb::off() {
     _strip.setPixelColor(0, 0);
-    _strip.show();
+    _dirty = true;
 }
 
 void NeopixelRgb::setLevel(uint8_t level) {
     _strip.setBrightness(level);
-    _strip.show();
+    _dirty = true;
 }
 
 void NeopixelRgb::update(uint32_t delta_ms) {
     // No-op
 }
 
+void NeopixelRgb::commit() {
+    if (_dirty) {
+        _strip.show();
+        _dirty = false;
+    }
+}
+
 }
@@ -45,11 +45,18 @@ void NeopixelRgbMulti::setLevel(uint8_t level) {
     for (uint16_t i = 0; i < _numPixels; i++) {
         _strip.setPixelColor(i, targetColor);
     }
-    _strip.show();
+    _dirty = true;
 }
 
 void NeopixelRgbMulti::update(uint32_t delta_ms) {
     // No-op
 }
 
+void NeopixelRgbMulti::commit() {
+    if (_dirty) {
+        _strip.show();
+        _dirty = false;
+    }
+}
+
 }
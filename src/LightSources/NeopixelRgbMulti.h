@@ -16,9 +16,11 @@ public:
     void off() override;
     void setLevel(uint8_t level) override;
     void update(uint32_t delta_ms) override;
+    void commit() override;
 
 private:
     Adafruit_NeoPixel _strip;
+    bool _dirty = false;
     uint32_t _color;
     uint16_t _numPixels;
 };
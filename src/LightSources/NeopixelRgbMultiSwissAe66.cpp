@@ -52,11 +52,18 @@ void NeopixelRgbMultiSwissAe66::setLevel(uint8_t level) {
         _strip.setPixelColor(i, 0);
     }
 
-    _strip.show();
+    _dirty = true;
 }
 
 void NeopixelRgbMultiSwissAe66::update(uint32_t delta_ms) {
     // No-op
 }
 
+void NeopixelRgbMultiSwissAe66::commit() {
+    if (_dirty) {
+        _strip.show();
+        _dirty = false;
+    }
+}
+
 }
@@ -0,0 +1,75 @@
+#include "NeopixelStrip.h"
+
+namespace xDuinoRails {
+
+NeopixelStrip::NeopixelStrip(uint8_t pin, uint16_t numPixels) :
+    _strip(numPixels, pin, NEO_GRB + NEO_KHZ800),
+    _numPixels(numPixels)
+{}
+
+void NeopixelStrip::begin() {
+    if (_begun) return;
+    _begun = true;
+    _strip.begin();
+    _strip.setBrightness(255); // Segments scale their colors themselves
+    _strip.show();
+}
+
+void NeopixelStrip::setPixelColor(uint16_t pixel, uint32_t color) {
+    if (pixel < _numPixels) {
+        _strip.setPixelColor(pixel, color);
+        _dirty = true;
+    }
+}
+
+void NeopixelStrip::commit() {
+    if (_dirty) {
+        _strip.show();
+        _dirty = false;
+    }
+}
+
+uint32_t NeopixelStrip::scaleColor(uint32_t color, uint8_t level) {
+    if (level == 255) return color;
+    uint8_t r = (uint8_t)(((uint16_t)(uint8_t)(color >> 16) * level) >> 8);
+    uint8_t g = (uint8_t)(((uint16_t)(uint8_t)(color >> 8) * level) >> 8);
+    uint8_t b = (uint8_t)(((uint16_t)(uint8_t)color * level) >> 8);
+    return Adafruit_NeoPixel::Color(r, g, b);
+}
+
+NeopixelSegment::NeopixelSegment(NeopixelStrip& strip, uint16_t first, uint16_t count, uint8_t r, uint8_t g, uint8_t b, uint16_t step) :
+    _strip(strip),
+    _color(Adafruit_NeoPixel::Color(r, g, b)),
+    _first(first),
+    _count(count),
+    _step(step > 0 ? step : 1)
+{}
+
+void NeopixelSegment::begin() {
+    _strip.begin();
+}
+
+void NeopixelSegment::on() {
+    setLevel(255);
+}
+
+void NeopixelSegment::off() {
+    setLevel(0);
+}
+
+void NeopixelSegment::setLevel(uint8_t level) {
+    uint32_t color = NeopixelStrip::scaleColor(_color, level);
+    for (uint16_t i = 0; i < _count; ++i) {
+        _strip.setPixelColor(_first + i * _step, color);
+    }
+}
+
+void NeopixelSegment::update(uint32_t delta_ms) {
+    // No-op
+}
+
+void NeopixelSegment::commit() {
+    _strip.commit();
+}
+
+}
@@ -0,0 +1,66 @@
+#ifndef NEOPIXELSTRIP_H
+#define NEOPIXELSTRIP_H
+
+#include "LightSource.h"
+#include <Adafruit_NeoPixel.h>
+
+namespace xDuinoRails {
+
+/**
+ * @brief A NeoPixel strip shared by several NeopixelSegment light sources.
+ *
+ * The strip owns the only pixel buffer. Segments write their pixels into it and the
+ * strip is transmitted at most once per frame, by the first segment committed after a
+ * change. The strip must outlive the segments that refer to it.
+ */
+class NeopixelStrip {
+public:
+    NeopixelStrip(uint8_t pin, uint16_t numPixels);
+
+    /** @brief Initializes the strip once; later calls do nothing. */
+    void begin();
+    void setPixelColor(uint16_t pixel, uint32_t color);
+    uint32_t getPixelColor(uint16_t pixel) const { return _strip.getPixelColor(pixel); }
+    /** @brief Transmits the buffer if any pixel changed since the last commit. */
+    void commit();
+    uint16_t numPixels() const { return _numPixels; }
+
+    /** @brief Scales a packed RGB color by level/256 per channel (255 keeps the color). */
+    static uint32_t scaleColor(uint32_t color, uint8_t level);
+
+private:
+    Adafruit_NeoPixel _strip;
+    uint16_t _numPixels;
+    bool _begun = false;
+    bool _dirty = false;
+};
+
+/**
+ * @brief Light source driving a range of pixels on a shared NeopixelStrip.
+ *
+ * The segment lights `count` pixels starting at `first`, `step` pixels apart, all in one
+ * color scaled by the level. A step of 2 over three pixels, for example, lights the outer
+ * two only (the Swiss Ae 6/6 tail light pattern).
+ */
+class NeopixelSegment : public LightSource {
+public:
+    NeopixelSegment(NeopixelStrip& strip, uint16_t first, uint16_t count, uint8_t r, uint8_t g, uint8_t b, uint16_t step = 1);
+
+    void begin() override;
+    void on() override;
+    void off() override;
+    void setLevel(uint8_t level) override;
+    void update(uint32_t delta_ms) override;
+    void commit() override;
+
+private:
+    NeopixelStrip& _strip;
+    uint32_t _color;
+    uint16_t _first;
+    uint16_t _count;
+    uint16_t _step;
+};
+
+}
+
+#endif // NEOPIXELSTRIP_H
@@ -5,19 +5,30 @@ namespace xDuinoRails {
 SingleLed::SingleLed(uint8_t pin) : _pin(pin) {}
 
 void SingleLed::begin() {
-    pinMode(_pin, OUTPUT);
+    _gpio.begin(_pin);
+    _pwm_active = false;
 }
 
 void SingleLed::on() {
-    digitalWrite(_pin, HIGH);
+    write(true);
 }
 
 void SingleLed::off() {
-    digitalWrite(_pin, LOW);
+    write(false);
+}
+
+void SingleLed::write(bool high) {
+    if (_pwm_active) {
+        digitalWrite(_pin, high ? HIGH : LOW); // Also detaches the PWM timer
+        _pwm_active = false;
+    } else {
+        _gpio.write(high);
+    }
 }
 
 void SingleLed::setLevel(uint8_t level) {
     analogWrite(_pin, level);
+    _pwm_active = level != 0 && level != 255;
 }
 
 void SingleLed::update(uint32_t delta_ms) {
@@ -2,6 +2,7 @@
 #define SINGLELED_H
 
 #include "LightSource.h"
+#include "../Gpio.h"
 #include <Arduino.h>
 
 namespace xDuinoRails {
@@ -17,7 +18,11 @@ public:
     void update(uint32_t delta_ms) override;
 
 private:
+    void write(bool high);
+
     uint8_t _pin;
+    GpioPin _gpio;
+    bool _pwm_active = false; // analogWrite() is running PWM, which port writes do not stop
 };
 
 }
@@ -0,0 +1,31 @@
+#include "SoftPwmLed.h"
+
+namespace xDuinoRails {
+
+SoftPwmLed::SoftPwmLed(SoftPwm& pwm, uint8_t pin) : _pwm(pwm), _pin(pin) {}
+
+void SoftPwmLed::begin() {
+    if (_begun) return;
+    _begun = true;
+    _channel = _pwm.addPin(_pin);
+    _pwm.begin();
+}
+
+void SoftPwmLed::on() {
+    _pwm.setLevel(_channel, _level);
+}
+
+void SoftPwmLed::off() {
+    _pwm.setLevel(_channel, 0);
+}
+
+void SoftPwmLed::setLevel(uint8_t level) {
+    _level = level;
+    _pwm.setLevel(_channel, level);
+}
+
+void SoftPwmLed::update(uint32_t delta_ms) {
+    // No-op: the engine's tick drives the pin
+}
+
+}
@@ -0,0 +1,34 @@
+#ifndef SOFTPWMLED_H
+#define SOFTPWMLED_H
+
+#include "LightSource.h"
+#include "../SoftPwm.h"
+
+namespace xDuinoRails {
+
+/**
+ * @brief An LED dimmed by a shared SoftPwm engine, so any pin can dim, not only PWM pins.
+ *
+ * The engine must outlive the LEDs that use it.
+ */
+class SoftPwmLed : public LightSource {
+public:
+    SoftPwmLed(SoftPwm& pwm, uint8_t pin);
+
+    void begin() override;
+    void on() override;
+    void off() override;
+    void setLevel(uint8_t level) override;
+    void update(uint32_t delta_ms) override;
+
+private:
+    SoftPwm& _pwm;
+    uint8_t _pin;
+    uint8_t _channel = 0;
+    bool _begun = false;
+    uint8_t _level = 255; // Restored by on()
+};
+
+}
+
+#endif // SOFTPWMLED_H
@@ -6,13 +6,36 @@ LogicalFunction::LogicalFunction(Effect* effect) : _effect(effect) {}
 
 LogicalFunction::~LogicalFunction() {
     delete _effect;
+    for (auto* output : _outputs) output->removeSource(this);
 }
 
 void LogicalFunction::addOutput(PhysicalOutput* output) {
     _outputs.push_back(output);
 }
 
+void LogicalFunction::setEffect(Effect* effect) {
+    bool active = isActive();
+    bool dimmed = isDimmed();
+    delete _effect;
+    _effect = effect;
+    if (_effect) {
+        _effect->attachClock(_clock, _stream);
+        _effect->setActive(active);
+        _effect->setDimmed(dimmed);
+    }
+    _pending = true;
+    _elapsed_ms = 0;
+    _next_update_ms = UPDATE_NEXT_TICK;
+}
+
+void LogicalFunction::attachClock(const EffectClock* clock, uint16_t stream) {
+    _clock = clock;
+    _stream = stream;
+    if (_effect) _effect->attachClock(clock, stream);
+}
+
 void LogicalFunction::setActive(bool active) {
+    _pending = true;
     if (_effect) _effect->setActive(active);
 }
 
@@ -21,6 +44,7 @@ bool LogicalFunction::isActive() const {
 }
 
 void LogicalFunction::setDimmed(bool dimmed) {
+    _pending = true;
     if (_effect) _effect->setDimmed(dimmed);
 }
 
@@ -28,10 +52,25 @@ bool LogicalFunction::isDimmed() const {
     return _effect ? _effect->isDimmed() : false;
 }
 
-void LogicalFunction::update(uint32_t delta_ms) {
-    if (_effect) {
-        _effect->update(delta_ms, _outputs);
+void LogicalFunction::setPriority(uint8_t priority) {
+    _priority = priority;
+    _pending = true;
+}
+
+uint32_t LogicalFunction::update(uint32_t delta_ms) {
+    if (!_effect) return UPDATE_IDLE;
+    if (_next_update_ms != UPDATE_IDLE) _elapsed_ms += delta_ms;
+    if (!_pending && _elapsed_ms < _next_update_ms) {
+        return (_next_update_ms == UPDATE_IDLE) ? UPDATE_IDLE : _next_update_ms - _elapsed_ms;
     }
+    // The effect's setValue() calls set this function's level on each output.
+    for (auto* output : _outputs) output->selectSource(this, _priority);
+    // An idle effect accumulates no time, so a state change restarts it from the latest delta.
+    _effect->update(_next_update_ms == UPDATE_IDLE ? delta_ms : _elapsed_ms, _outputs);
+    _pending = false;
+    _elapsed_ms = 0;
+    _next_update_ms = _effect->nextUpdateMs();
+    return _next_update_ms;
 }
 
 }
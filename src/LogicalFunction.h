@@ -13,15 +13,34 @@ public:
     ~LogicalFunction();
 
     void addOutput(PhysicalOutput* output);
-    void update(uint32_t delta_ms);
+    /** @brief Replaces the effect, carrying over the active and dimmed state. Takes ownership. */
+    void setEffect(Effect* effect);
+    /** @brief Connects this function's effects, now and after setEffect(), to a controller clock. */
+    void attachClock(const EffectClock* clock, uint16_t stream);
+    /**
+     * @brief Runs the effect if its state changed or its deadline has passed.
+     *
+     * Skipped time is accumulated and handed to the effect on its next run.
+     * @return Milliseconds until the effect needs to run again, or UPDATE_IDLE.
+     */
+    uint32_t update(uint32_t delta_ms);
     void setActive(bool active);
     bool isActive() const;
     void setDimmed(bool dimmed);
     bool isDimmed() const;
+    /** @brief Priority of this function's level on outputs that combine by PRIORITY or MULTIPLY. */
+    void setPriority(uint8_t priority);
+    uint8_t getPriority() const { return _priority; }
 
 private:
     Effect* _effect;
     std::vector<PhysicalOutput*> _outputs;
+    bool _pending = true; // State changed since the last effect update
+    uint32_t _elapsed_ms = 0; // Time skipped since the last effect update
+    uint32_t _next_update_ms = UPDATE_NEXT_TICK;
+    uint8_t _priority = 0;
+    const EffectClock* _clock = nullptr;
+    uint16_t _stream = 0; // Random stream of this function's effect
 };
 
 }
@@ -0,0 +1,65 @@
+#include "MappingImage.h"
+#include <cstring>
+
+namespace xDuinoRails {
+
+uint32_t mappingImageHash(const uint8_t* data, size_t size, uint32_t hash) {
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+uint32_t mappingImageHash(IMappingImageSource& source, size_t offset, size_t size, uint32_t hash) {
+    uint8_t block[MappingImageReader::BLOCK_SIZE];
+    while (size > 0) {
+        size_t count = size < sizeof(block) ? size : sizeof(block);
+        source.read(offset, block, count);
+        hash = mappingImageHash(block, count, hash);
+        offset += count;
+        size -= count;
+    }
+    return hash;
+}
+
+void MemoryMappingImageSource::read(size_t offset, uint8_t* buffer, size_t count) {
+    memcpy(buffer, _data + offset, count);
+}
+
+void MappingImageWriter::put16(uint16_t value) {
+    put8((uint8_t)value);
+    put8((uint8_t)(value >> 8));
+}
+
+void MappingImageWriter::put32(uint32_t value) {
+    put16((uint16_t)value);
+    put16((uint16_t)(value >> 16));
+}
+
+uint8_t MappingImageReader::get8() {
+    if (_next == _buffered) {
+        if (_offset == _end) {
+            _ok = false;
+            return 0;
+        }
+        size_t count = _end - _offset;
+        _buffered = (uint8_t)(count < BLOCK_SIZE ? count : BLOCK_SIZE);
+        _source.read(_offset, _buffer, _buffered);
+        _offset += _buffered;
+        _next = 0;
+    }
+    return _buffer[_next++];
+}
+
+uint16_t MappingImageReader::get16() {
+    uint16_t low = get8();
+    return low | (uint16_t)get8() << 8;
+}
+
+uint32_t MappingImageReader::get32() {
+    uint32_t low = get16();
+    return low | (uint32_t)get16() << 16;
+}
+
+}
@@ -0,0 +1,89 @@
+#ifndef MAPPINGIMAGE_H
+#define MAPPINGIMAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "interfaces/IMappingImageSource.h"
+
+namespace xDuinoRails {
+
+/**
+ * Layout of a compiled mapping image (see AuxController::saveMappingImage()).
+ * All multi-byte values are little endian.
+ *
+ *   header:  'x' 'M' version method source_key:u32 payload_hash:u32 change_counter:u32
+ *   payload: lf_count:u8        { output_num:u8 present:u8 effect_cv:u8[popcount(present)] }
+ *            condition_count:u16 { id:u16 n:u8 { source:u8 comparator:u8 parameter:u8 } }
+ *            rule_count:u16     { target:u8 action:u8 n:u8 index[n] n:u8 index[n] }
+ *            term_count:u16 shape_count:u16 { forward:u32 reverse:u32 blocking:u32 targets:u8[(lf_count + 7) / 8] }
+ *
+ * source_key is the hash of the CVs the mapping was compiled from and change_counter the
+ * ICVAccess::changeCounter() they had then. Each logical function carries its effect CVs, so
+ * loading reads no CV page when the counter still matches; bit i of `present` marks effect CV
+ * i as stored, the others are 0. A rule lists its positive, then its negative conditions as
+ * indices into the condition list (u8, or u16 if there are more than 255 conditions; the
+ * index condition_count stands for an unknown condition and never holds).
+ * Mask terms are stored once per distinct (forward, reverse, blocking) triple with a bitset of
+ * the logical functions they target: the bitmask methods repeat the same terms on every output.
+ */
+const uint8_t MAPPING_IMAGE_MAGIC_0 = 'x';
+const uint8_t MAPPING_IMAGE_MAGIC_1 = 'M';
+const uint8_t MAPPING_IMAGE_VERSION = 3;
+const size_t MAPPING_IMAGE_HEADER_SIZE = 16;
+
+/** @brief 32-bit FNV-1a hash; pass the previous result as `hash` to continue it. */
+uint32_t mappingImageHash(const uint8_t* data, size_t size, uint32_t hash = 2166136261u);
+/** @brief mappingImageHash() over `size` bytes of @p source starting at `offset`. */
+uint32_t mappingImageHash(IMappingImageSource& source, size_t offset, size_t size, uint32_t hash = 2166136261u);
+
+/** @brief IMappingImageSource over an image in RAM. */
+class MemoryMappingImageSource : public IMappingImageSource {
+public:
+    MemoryMappingImageSource(const uint8_t* data, size_t size) : _data(data), _size(size) {}
+    size_t size() override { return _size; }
+    void read(size_t offset, uint8_t* buffer, size_t count) override;
+private:
+    const uint8_t* _data;
+    size_t _size;
+};
+
+class MappingImageWriter {
+public:
+    explicit MappingImageWriter(std::vector<uint8_t>& image) : _image(image) {}
+    void put8(uint8_t value) { _image.push_back(value); }
+    void put16(uint16_t value);
+    void put32(uint32_t value);
+private:
+    std::vector<uint8_t>& _image;
+};
+
+/**
+ * @brief Bounds-checked reader over `size` bytes of a source, starting at `offset`.
+ *
+ * Reads the source in blocks of BLOCK_SIZE bytes. Once a read runs past the end, ok() stays
+ * false and reads return 0.
+ */
+class MappingImageReader {
+public:
+    static const uint8_t BLOCK_SIZE = 16;
+    MappingImageReader(IMappingImageSource& source, size_t offset, size_t size) :
+        _source(source), _offset(offset), _end(offset + size) {}
+    uint8_t get8();
+    uint16_t get16();
+    uint32_t get32();
+    bool ok() const { return _ok; }
+    bool atEnd() const { return _next == _buffered && _offset == _end; }
+private:
+    IMappingImageSource& _source;
+    size_t _offset; // Next byte to fetch from the source
+    size_t _end;
+    uint8_t _buffer[BLOCK_SIZE];
+    uint8_t _buffered = 0;
+    uint8_t _next = 0;
+    bool _ok = true;
+};
+
+}
+
+#endif // MAPPINGIMAGE_H
@@ -1,11 +1,13 @@
 #include "PhysicalOutput.h"
+#include <algorithm>
 
 namespace xDuinoRails {
 
 PhysicalOutput::PhysicalOutput(std::unique_ptr<LightSource> lightSource) :
     _type(OutputType::LIGHT_SOURCE),
     _lightSource(std::move(lightSource)),
-    _pin(0)
+    _pin(0),
+    _curve(_lightSource->brightnessCurve())
 {}
 
 PhysicalOutput::PhysicalOutput(uint8_t pin) :
@@ -15,6 +17,7 @@ PhysicalOutput::PhysicalOutput(uint8_t pin) :
 {}
 
 void PhysicalOutput::begin() {
+    _has_value = false;
     if (_type == OutputType::LIGHT_SOURCE) {
         _lightSource->begin();
     } else {
@@ -22,27 +25,153 @@ void PhysicalOutput::begin() {
     }
 }
 
+bool PhysicalOutput::isUnchanged(uint16_t value) {
+    if (_has_value && _last_value == value) {
+        ++_elided_writes;
+        return true;
+    }
+    _has_value = true;
+    _last_value = value;
+    return false;
+}
+
 void PhysicalOutput::setValue(uint8_t value) {
-    if (_type == OutputType::LIGHT_SOURCE) {
-        if (value > 0) {
-            _lightSource->on();
-            _lightSource->setLevel(value);
+    setValue16((uint16_t)value * 257);
+}
+
+void PhysicalOutput::setValue16(uint16_t value) {
+    if (_type != OutputType::LIGHT_SOURCE) return;
+    selectSource(_writer, _writer_priority);
+    for (auto& source : _sources) {
+        if (source.owner != _writer) continue;
+        if (source.level == value) {
+            ++_elided_writes;
         } else {
-            _lightSource->off();
+            source.level = value;
+            _levels_changed = true;
         }
+        return;
     }
 }
 
+void PhysicalOutput::selectSource(const void* owner, uint8_t priority) {
+    _writer = owner;
+    _writer_priority = priority;
+    for (auto& source : _sources) {
+        if (source.owner == owner) {
+            source.priority = priority;
+            return;
+        }
+    }
+    _sources.push_back({owner, priority, 0});
+}
+
+void PhysicalOutput::removeSource(const void* owner) {
+    for (auto it = _sources.begin(); it != _sources.end(); ++it) {
+        if (it->owner != owner) continue;
+        _sources.erase(it);
+        _levels_changed = true;
+        break;
+    }
+    if (_writer == owner) _writer = nullptr;
+}
+
+void PhysicalOutput::setCombineMode(CombineMode mode) {
+    _combine_mode = mode;
+    _levels_changed = true;
+}
+
+void PhysicalOutput::setBrightnessCurve(BrightnessCurve curve) {
+    _curve = curve;
+    _levels_changed = true;
+}
+
+uint16_t PhysicalOutput::combinedLevel() const {
+    uint32_t level = 0;
+    switch (_combine_mode) {
+        case CombineMode::PRIORITY: {
+            int best = -1;
+            for (const auto& source : _sources) {
+                if (source.level > 0 && source.priority >= best) {
+                    best = source.priority;
+                    level = source.level;
+                }
+            }
+            break;
+        }
+        case CombineMode::ADD:
+            for (const auto& source : _sources) level = std::min<uint32_t>(0xFFFF, level + source.level);
+            break;
+        case CombineMode::MULTIPLY:
+            for (const auto& source : _sources) {
+                if (source.priority == 0) level = std::max<uint32_t>(level, source.level);
+            }
+            for (const auto& source : _sources) {
+                if (source.priority > 0 && source.level > 0) level = level * source.level / 0xFFFF;
+            }
+            break;
+        case CombineMode::MAX:
+        default:
+            for (const auto& source : _sources) level = std::max<uint32_t>(level, source.level);
+            break;
+    }
+    return (uint16_t)level;
+}
+
 void PhysicalOutput::setServoAngle(uint16_t angle) {
     if (_type == OutputType::SERVO) {
+        if (isUnchanged(angle)) return;
         _servo.write(angle);
     }
 }
 
-void PhysicalOutput::update(uint32_t delta_ms) {
-    if (_type == OutputType::LIGHT_SOURCE) {
-        _lightSource->update(delta_ms);
+uint32_t PhysicalOutput::update(uint32_t delta_ms) {
+    if (_type != OutputType::LIGHT_SOURCE || _lightSource->nextUpdateMs() == UPDATE_IDLE) {
+        return UPDATE_IDLE;
+    }
+    _lightSource->update(delta_ms);
+    return _lightSource->nextUpdateMs();
+}
+
+uint8_t PhysicalOutput::ditheredLevel(uint16_t level, bool settled) {
+    if (level == 0) {
+        _dither_error = 0;
+        return 0;
+    }
+    if (level < 257) level = 257; // A lit output never dithers down to off
+    if (settled) {
+        _dither_error = 0;
+        return (uint8_t)((level + 128) / 257);
     }
+    uint32_t accumulated = (uint32_t)level + _dither_error;
+    uint8_t value = (uint8_t)(accumulated / 257);
+    _dither_error = (uint16_t)(accumulated - value * 257u);
+    return value;
+}
+
+uint32_t PhysicalOutput::render() {
+    if (_type != OutputType::LIGHT_SOURCE || (!_levels_changed && _dither_error == 0)) return UPDATE_IDLE;
+    bool settled = !_levels_changed;
+    _levels_changed = false;
+    uint16_t level = applyBrightnessCurve(_curve, combinedLevel());
+    bool fine = _lightSource->hasFineLevels();
+    uint16_t value = fine ? level : ditheredLevel(level, settled);
+    if (!isUnchanged(value)) {
+        if (value == 0) {
+            _lightSource->off();
+        } else {
+            _lightSource->on();
+            if (fine) _lightSource->setLevel16(value);
+            else _lightSource->setLevel((uint8_t)value);
+        }
+    }
+    return _dither_error != 0 ? UPDATE_NEXT_TICK : UPDATE_IDLE;
+}
+
+void PhysicalOutput::commit() {
+    if (_type != OutputType::LIGHT_SOURCE) return;
+    if (_levels_changed) render(); // The rounding write after dithering waits for the next frame
+    _lightSource->commit();
 }
 
 }
@@ -3,6 +3,7 @@
 
 #include <cstdint>
 #include <memory>
+#include <vector>
 #include <Servo.h>
 #include "LightSources/LightSource.h"
 
@@ -13,20 +14,79 @@ enum class OutputType {
     SERVO
 };
 
+/** @brief How a light output combines the levels of the logical functions driving it. */
+enum class CombineMode : uint8_t {
+    MAX,      ///< The brightest level wins.
+    PRIORITY, ///< The non-zero level of the highest-priority source wins; the later source wins a tie.
+    ADD,      ///< Levels add up, saturating at 255.
+    MULTIPLY, ///< The brightest priority-0 level, scaled by every non-zero higher-priority level (dimmers).
+};
+
 class PhysicalOutput {
 public:
     PhysicalOutput(std::unique_ptr<LightSource> lightSource);
     PhysicalOutput(uint8_t pin); // For Servo
     void begin();
+    /**
+     * @brief Sets the level of the selected source for this frame.
+     *
+     * Levels are combined, corrected by the brightness curve and sent to the light source
+     * by commit(), once per frame.
+     */
     void setValue(uint8_t value);
+    /** @brief setValue() with a 16-bit level (0xFFFF is full brightness). */
+    void setValue16(uint16_t value);
     void setServoAngle(uint16_t angle);
-    void update(uint32_t delta_ms);
+    /** @brief Updates the light source unless it is idle; returns its next deadline in ms. */
+    uint32_t update(uint32_t delta_ms);
+    /**
+     * @brief Combines the source levels if any changed and writes the result to the light source.
+     *
+     * Sources without fine levels get the level dithered to 8 bits: the rounding error is
+     * carried into the next frame, so a fade between two 8-bit steps averages out in between.
+     * Once the level stops changing, the next render() writes it rounded and ends dithering.
+     * @return UPDATE_NEXT_TICK while that rounding write is due, otherwise UPDATE_IDLE.
+     */
+    uint32_t render();
+    /** @brief render()s any changed levels, then transmits the light source's buffered changes. */
+    void commit();
+
+    /** @brief Makes following setValue() calls set the level of this source, adding it if new. */
+    void selectSource(const void* owner, uint8_t priority = 0);
+    /** @brief Drops a source, e.g. a logical function that is being deleted. */
+    void removeSource(const void* owner);
+    void setCombineMode(CombineMode mode);
+    /** @brief Overrides the light source's brightness curve (see LightSource::brightnessCurve()). */
+    void setBrightnessCurve(BrightnessCurve curve);
+
+    /** @brief Number of writes skipped because the value did not change. */
+    uint32_t getElidedWriteCount() const { return _elided_writes; }
 
 private:
+    struct Source {
+        const void* owner;
+        uint8_t priority;
+        uint16_t level;
+    };
+
+    bool isUnchanged(uint16_t value);
+    uint16_t combinedLevel() const;
+    uint8_t ditheredLevel(uint16_t level, bool settled);
+
     OutputType _type;
     std::unique_ptr<LightSource> _lightSource;
     Servo _servo;
     uint8_t _pin; // For Servo
+    bool _has_value = false; // False until the first write after begin()
+    uint16_t _last_value = 0; // Last level or angle passed to the hardware
+    uint32_t _elided_writes = 0;
+    std::vector<Source> _sources;
+    const void* _writer = nullptr; // Source set by setValue(); nullptr for direct writes
+    uint8_t _writer_priority = 0;
+    bool _levels_changed = false;  // A source level changed since the last commit()
+    CombineMode _combine_mode = CombineMode::MAX;
+    BrightnessCurve _curve = BrightnessCurve::LINEAR;
+    uint16_t _dither_error = 0; // Carried into the next frame, in 1/257ths of an 8-bit step
 };
 
 }
@@ -0,0 +1,18 @@
+#ifndef SCHEDULING_H
+#define SCHEDULING_H
+
+#include <cstdint>
+
+namespace xDuinoRails {
+
+// Deadlines reported by Effect::nextUpdateMs(), LightSource::nextUpdateMs() and
+// AuxController::update(), in milliseconds from now.
+
+/** @brief Needs service on the next update (continuous animation). */
+const uint32_t UPDATE_NEXT_TICK = 0;
+/** @brief Needs no service until one of its inputs changes. */
+const uint32_t UPDATE_IDLE = 0xFFFFFFFF;
+
+}
+
+#endif // SCHEDULING_H
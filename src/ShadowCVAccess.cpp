@@ -0,0 +1,130 @@
+#include "ShadowCVAccess.h"
+#include <algorithm>
+
+namespace xDuinoRails {
+
+ShadowCVAccess::ShadowCVAccess(ICVAccess& backing, uint32_t flush_delay_ms) :
+    _backing(backing),
+    _flush_delay_ms(flush_delay_ms)
+{}
+
+bool ShadowCVAccess::isIndexed(uint16_t cv_number) {
+    return cv_number >= CV_INDEXED_WINDOW_START && cv_number < CV_INDEXED_WINDOW_START + CV_INDEXED_WINDOW_SIZE;
+}
+
+uint32_t ShadowCVAccess::makeKey(uint16_t page, uint16_t cv_number) {
+    return isIndexed(cv_number) ? ((uint32_t)page << 16) | cv_number : cv_number;
+}
+
+uint16_t ShadowCVAccess::selectedPage() {
+    // Read one at a time: fetching the second CV may insert and move the first entry.
+    uint8_t high = fetch(0, CV_INDEXED_CV_HIGH_BYTE).value;
+    uint8_t low = fetch(0, CV_INDEXED_CV_LOW_BYTE).value;
+    return (uint16_t)high << 8 | low;
+}
+
+ShadowCVAccess::Entry* ShadowCVAccess::find(uint32_t key) {
+    auto it = std::lower_bound(_entries.begin(), _entries.end(), key,
+                               [](const Entry& entry, uint32_t k) { return entry.key < k; });
+    return (it != _entries.end() && it->key == key) ? &*it : nullptr;
+}
+
+ShadowCVAccess::Entry& ShadowCVAccess::insert(uint32_t key, uint8_t value) {
+    auto it = std::lower_bound(_entries.begin(), _entries.end(), key,
+                               [](const Entry& entry, uint32_t k) { return entry.key < k; });
+    return *_entries.insert(it, Entry{key, value, false});
+}
+
+ShadowCVAccess::Entry& ShadowCVAccess::fetch(uint16_t page, uint16_t cv_number) {
+    uint32_t key = makeKey(page, cv_number);
+    Entry* entry = find(key);
+    if (entry) return *entry;
+    uint8_t value;
+    readBacking(page, cv_number, 1, &value);
+    return insert(key, value);
+}
+
+uint8_t ShadowCVAccess::readCV(uint16_t cv_number) {
+    uint16_t page = isIndexed(cv_number) ? selectedPage() : 0;
+    return fetch(page, cv_number).value;
+}
+
+void ShadowCVAccess::writeCV(uint16_t cv_number, uint8_t value) {
+    uint16_t page = isIndexed(cv_number) ? selectedPage() : 0;
+    Entry& entry = fetch(page, cv_number);
+    if (entry.value == value) return;
+    entry.value = value;
+    if (!entry.dirty) {
+        entry.dirty = true;
+        ++_dirty_count;
+    }
+    _quiet_ms = 0;
+}
+
+void ShadowCVAccess::readCVs(uint16_t page, uint16_t first_cv, uint16_t count, uint8_t* buffer) {
+    bool complete = true;
+    for (uint16_t i = 0; i < count && complete; ++i) {
+        complete = find(makeKey(page, first_cv + i)) != nullptr;
+    }
+    if (!complete) {
+        // One block read from the backing store; cached values (possibly dirty) take precedence.
+        readBacking(page, first_cv, count, buffer);
+        _entries.reserve(_entries.size() + count);
+        for (uint16_t i = 0; i < count; ++i) {
+            uint32_t key = makeKey(page, first_cv + i);
+            if (!find(key)) insert(key, buffer[i]);
+        }
+    }
+    for (uint16_t i = 0; i < count; ++i) {
+        buffer[i] = find(makeKey(page, first_cv + i))->value;
+    }
+}
+
+uint16_t ShadowCVAccess::backingPage() {
+    return (uint16_t)_backing.readCV(CV_INDEXED_CV_HIGH_BYTE) << 8 | _backing.readCV(CV_INDEXED_CV_LOW_BYTE);
+}
+
+void ShadowCVAccess::readBacking(uint16_t page, uint16_t first_cv, uint16_t count, uint8_t* buffer) {
+    if (first_cv + count <= CV_INDEXED_WINDOW_START || first_cv >= CV_INDEXED_WINDOW_START + CV_INDEXED_WINDOW_SIZE) {
+        _backing.readCVs(page, first_cv, count, buffer);
+        return;
+    }
+    // The backing store may select the page through CV31/CV32 (the default readCVs() does);
+    // put its selection back so that reading never changes what is stored.
+    uint16_t saved_page = backingPage();
+    _backing.readCVs(page, first_cv, count, buffer);
+    uint16_t backing_page = backingPage();
+    selectBackingPage(saved_page, backing_page);
+}
+
+void ShadowCVAccess::selectBackingPage(uint16_t page, uint16_t& backing_page) {
+    if (page == backing_page) return;
+    if ((page >> 8) != (backing_page >> 8)) _backing.writeCV(CV_INDEXED_CV_HIGH_BYTE, (uint8_t)(page >> 8));
+    if ((page & 0xFF) != (backing_page & 0xFF)) _backing.writeCV(CV_INDEXED_CV_LOW_BYTE, (uint8_t)page);
+    backing_page = page;
+}
+
+void ShadowCVAccess::flush() {
+    if (_dirty_count == 0) return;
+    uint16_t backing_page = backingPage();
+    // Entries are sorted by key, so all dirty CVs of a page are written after one page switch.
+    for (auto& entry : _entries) {
+        if (!entry.dirty) continue;
+        entry.dirty = false;
+        uint16_t cv_number = (uint16_t)entry.key;
+        if (cv_number == CV_INDEXED_CV_HIGH_BYTE || cv_number == CV_INDEXED_CV_LOW_BYTE) continue; // Restored below
+        if (isIndexed(cv_number)) selectBackingPage((uint16_t)(entry.key >> 16), backing_page);
+        _backing.writeCV(cv_number, entry.value);
+    }
+    // Leave the backing store on the page selected through this shadow.
+    selectBackingPage(selectedPage(), backing_page);
+    _dirty_count = 0;
+}
+
+void ShadowCVAccess::update(uint32_t delta_ms) {
+    if (_dirty_count == 0) return;
+    _quiet_ms += delta_ms;
+    if (_quiet_ms >= _flush_delay_ms) flush();
+}
+
+}
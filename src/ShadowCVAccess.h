@@ -0,0 +1,66 @@
+#ifndef SHADOWCVACCESS_H
+#define SHADOWCVACCESS_H
+
+#include "interfaces/ICVAccess.h"
+#include <vector>
+
+namespace xDuinoRails {
+
+/**
+ * @brief ICVAccess decorator that keeps a RAM copy of the CVs it has seen.
+ *
+ * CVs are fetched from the backing store on first use and served from RAM afterwards.
+ * Indexed CVs (257-512) are cached per page, using the page selected in the shadowed
+ * CV31/CV32, so switching pages costs nothing. Writes only update the copy; repeated writes
+ * to a CV, and writes that restore its stored value, reach the backing store at most once.
+ * flush() writes the dirty bytes back, grouped by page; update() does so automatically once
+ * no CV has been written for the configured flush delay. Reads leave the backing store's
+ * CV31/CV32 as they were, even when its readCVs() selects pages through them.
+ */
+class ShadowCVAccess : public ICVAccess {
+public:
+    /**
+     * @param backing The store to mirror, e.g. an EEPROM-backed ICVAccess.
+     * @param flush_delay_ms Quiet time after the last write before update() flushes.
+     */
+    ShadowCVAccess(ICVAccess& backing, uint32_t flush_delay_ms = 1000);
+
+    uint8_t readCV(uint16_t cv_number) override;
+    void writeCV(uint16_t cv_number, uint8_t value) override;
+    void readCVs(uint16_t page, uint16_t first_cv, uint16_t count, uint8_t* buffer) override;
+
+    /** @brief Writes all dirty CVs to the backing store. */
+    void flush();
+    /** @brief Flushes once the flush delay has passed since the last write. Call every loop. */
+    void update(uint32_t delta_ms);
+    void setFlushDelay(uint32_t flush_delay_ms) { _flush_delay_ms = flush_delay_ms; }
+    /** @brief Number of CVs written but not yet flushed. */
+    uint16_t dirtyCount() const { return _dirty_count; }
+
+private:
+    struct Entry {
+        uint32_t key; // (page << 16) | cv for indexed CVs, the CV number otherwise
+        uint8_t value;
+        bool dirty;
+    };
+
+    static bool isIndexed(uint16_t cv_number);
+    static uint32_t makeKey(uint16_t page, uint16_t cv_number);
+    uint16_t selectedPage();
+    Entry& fetch(uint16_t page, uint16_t cv_number);
+    Entry* find(uint32_t key);
+    Entry& insert(uint32_t key, uint8_t value);
+    uint16_t backingPage();
+    void readBacking(uint16_t page, uint16_t first_cv, uint16_t count, uint8_t* buffer);
+    void selectBackingPage(uint16_t page, uint16_t& backing_page);
+
+    ICVAccess& _backing;
+    std::vector<Entry> _entries; // Sorted by key
+    uint16_t _dirty_count = 0;
+    uint32_t _flush_delay_ms;
+    uint32_t _quiet_ms = 0;
+};
+
+}
+
+#endif // SHADOWCVACCESS_H
@@ -0,0 +1,90 @@
+#include "SoftPwm.h"
+#include "TickTimer.h"
+
+namespace xDuinoRails {
+
+static SoftPwm* s_timer_owner = nullptr;
+
+SoftPwm::SoftPwm(uint16_t tick_us) : _tick_us(tick_us) {}
+
+SoftPwm::~SoftPwm() {
+    if (s_timer_owner == this) {
+        stopTickTimer();
+        s_timer_owner = nullptr;
+    }
+}
+
+void SoftPwm::onTick() {
+    s_timer_owner->tick();
+}
+
+bool SoftPwm::begin() {
+    if (_begun) return true;
+    if (s_timer_owner) return false;
+    if (!startTickTimer(_tick_us, &SoftPwm::onTick)) return false;
+    s_timer_owner = this;
+    _begun = true;
+    return true;
+}
+
+uint8_t SoftPwm::addPin(uint8_t pin) {
+    Channel channel;
+    channel.pin.begin(pin);
+    channel.level = 0;
+    channel.port = 0;
+    while (channel.port < _ports.size() && !_ports[channel.port].port.samePort(channel.pin.port())) ++channel.port;
+    noInterrupts(); // The tick must not see the vectors while they grow
+    if (channel.port == _ports.size()) {
+        Port port = {};
+        port.port = channel.pin.port();
+        _ports.push_back(port);
+    }
+    _ports[channel.port].pins |= channel.pin.mask();
+    _channels.push_back(channel);
+    interrupts();
+    return (uint8_t)(_channels.size() - 1);
+}
+
+void SoftPwm::addListener(TickListener* listener) {
+    noInterrupts();
+    _listeners.push_back(listener);
+    interrupts();
+}
+
+void SoftPwm::removeListener(TickListener* listener) {
+    noInterrupts();
+    for (auto it = _listeners.begin(); it != _listeners.end(); ++it) {
+        if (*it == listener) {
+            _listeners.erase(it);
+            break;
+        }
+    }
+    interrupts();
+}
+
+void SoftPwm::setLevel(uint8_t channel, uint8_t level) {
+    if (channel >= _channels.size()) return;
+    Channel& c = _channels[channel];
+    c.level = level;
+    GpioMask mask = c.pin.mask();
+    Port& port = _ports[c.port];
+    for (uint8_t bit = 0; bit < 8; ++bit) {
+        if (level & (1 << bit)) port.planes[bit] |= mask;
+        else port.planes[bit] &= (GpioMask)~mask;
+    }
+}
+
+void SoftPwm::tick() {
+    // Bit b starts at tick 2^b - 1, i.e. when _tick + 1 is a power of two.
+    if ((_tick & (_tick + 1)) == 0) {
+        for (auto& port : _ports) port.port.write(port.pins, port.planes[_plane]);
+        ++_plane;
+    }
+    if (++_tick == 255) {
+        _tick = 0;
+        _plane = 0;
+    }
+    for (auto* listener : _listeners) listener->onTick();
+}
+
+}
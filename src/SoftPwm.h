@@ -0,0 +1,96 @@
+#ifndef SOFTPWM_H
+#define SOFTPWM_H
+
+#include <cstdint>
+#include <vector>
+#include "Gpio.h"
+
+/**
+ * Compiler barrier for handing buffers to onTick(). Volatile accesses are only ordered
+ * against each other, so without it the compiler may move ordinary buffer stores past the
+ * volatile "pending" flag that publishes them. Use it before setting the flag, and in the
+ * tick after reading it. The targets are single core, so no CPU fence is needed.
+ */
+#if defined(__GNUC__)
+#define XDRAILS_TICK_BARRIER() __asm__ __volatile__("" ::: "memory")
+#else
+#include <atomic>
+#define XDRAILS_TICK_BARRIER() std::atomic_signal_fence(std::memory_order_seq_cst)
+#endif
+
+namespace xDuinoRails {
+
+/** @brief A light source multiplexed from SoftPwm's tick, next to its own PWM pins. */
+class TickListener {
+public:
+    virtual ~TickListener() {}
+    /** @brief Called from the timer interrupt on every tick; must be short. */
+    virtual void onTick() = 0;
+};
+
+/**
+ * @brief 8-bit software PWM on any pin, by bit-angle modulation from one periodic tick.
+ *
+ * A frame is 255 ticks, in which bit b of every level is shown for 2^b ticks. The tick
+ * therefore only writes at the 8 bit changes per frame, one precomputed mask per port,
+ * so its cost does not grow with the number of pins on a port. With the default 32 us
+ * tick a frame lasts 8.2 ms (122 Hz).
+ *
+ * Only one SoftPwm can own the tick timer. Sources that multiplex, such as
+ * CharlieplexedLeds, attach to the same tick with addListener().
+ *
+ * On AVR the tick timer is Timer2, and its interrupt handler only exists if the sketch
+ * includes Timer2TickIsr.h. tone(), IRremote and MsTimer2 define the same handler
+ * (TIMER2_COMPA_vect), so a sketch using any of them must leave that header out, and
+ * analogWrite() stops working on the Timer2 pins (3 and 11 on an Uno) either way. Without
+ * the header begin() returns false; call tick() every tickMicros() from another timer then.
+ */
+class SoftPwm {
+public:
+    explicit SoftPwm(uint16_t tick_us = 32);
+    ~SoftPwm();
+
+    /**
+     * @brief Starts the tick timer; later calls do nothing.
+     * @return False if the target has no tick timer, or Timer2TickIsr.h is not included on
+     *         AVR (see startTickTimer()); call tick() then.
+     */
+    bool begin();
+    /** @brief Makes a pin an output, off, and returns its channel. */
+    uint8_t addPin(uint8_t pin);
+    /** @brief Sets a channel's duty cycle to level/255, from the next bit change on. */
+    void setLevel(uint8_t channel, uint8_t level);
+    uint8_t getLevel(uint8_t channel) const { return _channels[channel].level; }
+    /** @brief Calls the listener on every tick from now on. */
+    void addListener(TickListener* listener);
+    void removeListener(TickListener* listener);
+    /** @brief Advances one tick; called from the timer interrupt. */
+    void tick();
+    uint16_t tickMicros() const { return _tick_us; }
+
+private:
+    struct Port {
+        GpioPort port;
+        GpioMask pins;      // Pins of this port driven by the PWM
+        GpioMask planes[8]; // Pins to set while bit b is shown
+    };
+    struct Channel {
+        GpioPin pin;
+        uint8_t port;
+        uint8_t level;
+    };
+
+    static void onTick();
+
+    std::vector<Port> _ports;
+    std::vector<Channel> _channels;
+    std::vector<TickListener*> _listeners;
+    uint16_t _tick_us;
+    uint8_t _tick = 0;  // Position in the frame, 0..254
+    uint8_t _plane = 0; // Next bit to show
+    bool _begun = false;
+};
+
+}
+
+#endif // SOFTPWM_H
@@ -0,0 +1,60 @@
+#include "TickTimer.h"
+#include <Arduino.h>
+
+namespace xDuinoRails {
+
+#if defined(XDRAILS_VIRTUAL_HARDWARE)
+
+bool startTickTimer(uint16_t period_us, void (*callback)()) {
+    VirtualHardware::attachTimer(period_us, callback);
+    return true;
+}
+
+void stopTickTimer() {
+    VirtualHardware::detachTimer();
+}
+
+#elif defined(__AVR__) && defined(TCCR2A) && defined(OCIE2A)
+
+static void (*volatile s_tick_callback)() = nullptr;
+
+// Replaced by the definition in Timer2TickIsr.h. Without the handler, enabling the compare
+// interrupt would jump to the default vector and reset the board.
+__attribute__((weak)) bool timer2TickIsrInstalled() {
+    return false;
+}
+
+void onTimer2Tick() {
+    if (s_tick_callback) s_tick_callback();
+}
+
+bool startTickTimer(uint16_t period_us, void (*callback)()) {
+    if (!timer2TickIsrInstalled()) return false;
+    uint32_t counts = (uint32_t)period_us * (F_CPU / 8000000UL); // clk/8
+    if (counts == 0 || counts > 256) return false;
+    noInterrupts();
+    s_tick_callback = callback;
+    TCCR2A = _BV(WGM21); // CTC, TOP = OCR2A
+    TCCR2B = _BV(CS21);
+    OCR2A = (uint8_t)(counts - 1);
+    TCNT2 = 0;
+    TIMSK2 |= _BV(OCIE2A);
+    interrupts();
+    return true;
+}
+
+void stopTickTimer() {
+    TIMSK2 &= (uint8_t)~_BV(OCIE2A);
+}
+
+#else
+
+bool startTickTimer(uint16_t period_us, void (*callback)()) {
+    return false;
+}
+
+void stopTickTimer() {}
+
+#endif
+
+}
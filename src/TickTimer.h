@@ -0,0 +1,31 @@
+#ifndef TICKTIMER_H
+#define TICKTIMER_H
+
+#include <cstdint>
+
+namespace xDuinoRails {
+
+/**
+ * @brief Calls callback every period_us from a timer interrupt.
+ *
+ * AVR uses Timer2 in CTC mode (periods up to 128 us at 16 MHz), which takes it away from
+ * tone() and analogWrite() on the pins it drives. Its interrupt handler is opt-in: include
+ * Timer2TickIsr.h in one source file of the sketch to install it. The host build uses the
+ * virtual timer.
+ * @return False if this target has no backend, or the AVR handler is not installed; call the
+ *         callback from a timer yourself then.
+ */
+bool startTickTimer(uint16_t period_us, void (*callback)());
+
+/** @brief Stops the callbacks started by startTickTimer(). */
+void stopTickTimer();
+
+// AVR only: the hooks Timer2TickIsr.h connects the interrupt handler through.
+/** @brief Runs the tick callback from the Timer2 compare interrupt. */
+void onTimer2Tick();
+/** @brief True if the sketch includes Timer2TickIsr.h; the library's weak default returns false. */
+bool timer2TickIsrInstalled();
+
+}
+
+#endif // TICKTIMER_H
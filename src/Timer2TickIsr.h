@@ -0,0 +1,34 @@
+/**
+ * @file Timer2TickIsr.h
+ * @brief Installs the Timer2 compare interrupt that drives startTickTimer() on AVR.
+ *
+ * Include this header in exactly one source file of the sketch, usually the .ino, to let
+ * SoftPwm::begin() run the tick from Timer2. It is not part of the library's own sources
+ * because TIMER2_COMPA_vect is also defined by tone(), IRremote and MsTimer2; a sketch that
+ * uses one of those cannot include it (the link fails with a multiple definition of
+ * __vector_7) and calls SoftPwm::tick() from its own timer instead.
+ * On other targets this header does nothing.
+ */
+#ifndef TIMER2TICKISR_H
+#define TIMER2TICKISR_H
+
+#include "TickTimer.h"
+
+#if !defined(XDRAILS_VIRTUAL_HARDWARE) && defined(__AVR__)
+#include <Arduino.h>
+
+#if defined(TCCR2A) && defined(OCIE2A)
+namespace xDuinoRails {
+bool timer2TickIsrInstalled() {
+    return true;
+}
+}
+
+ISR(TIMER2_COMPA_vect) {
+    xDuinoRails::onTimer2Tick();
+}
+#endif
+
+#endif
+
+#endif // TIMER2TICKISR_H
@@ -85,6 +85,11 @@
 #define DECODER_DEFAULT_F6_MAPPING 128   // Map F6 to Output 8
 #define DECODER_DEFAULT_FUNCTION_MAPPING_METHOD 1 // Use RCN-225 standard mapping by default
 
+// --- Indexed CV Window ---
+// CVs 257-512 show the page selected by CV31 (high byte) and CV32 (low byte).
+#define CV_INDEXED_WINDOW_START 257
+#define CV_INDEXED_WINDOW_SIZE 256
+
 // --- RCN-227 Indexed CV Page Numbers ---
 #define RCN227_PER_FUNCTION_PAGE 40
 #define RCN227_PER_OUTPUT_V1_PAGE 41
@@ -93,8 +98,7 @@
 
 // --- Condition Variable ID Base Offsets ---
 // Used to generate unique IDs for ConditionVariables to avoid collisions.
-#define CV_ID_BASE_RCN227_PER_FUNCTION_BLOCKING 100
-#define CV_ID_BASE_RCN227_PER_OUTPUT_V1 200
+// RCN-225, RCN-227 per-function and per-output V1 are compiled to FunctionMaskTerms instead.
 #define CV_ID_BASE_RCN227_PER_OUTPUT_V2_BLOCKING 400
 #define CV_ID_BASE_RCN227_PER_OUTPUT_V2 500
 #define CV_ID_BASE_RCN227_PER_OUTPUT_V3 700
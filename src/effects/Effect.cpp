@@ -8,6 +8,11 @@
 
 namespace xDuinoRails {
 
+void Effect::attachClock(const EffectClock* clock, uint16_t stream) {
+    _clock = clock;
+    _random.reseed(clock ? clock->seed() : 0, stream);
+}
+
 EffectSteady::EffectSteady(uint8_t brightness) : _brightness(brightness) {}
 
 void EffectSteady::update(uint32_t delta_ms, const std::vector<PhysicalOutput*>& outputs) {
@@ -37,12 +42,17 @@ void EffectDimming::setDimmed(bool dimmed) {
 // Refactored EffectFlicker to use FastLED inoise8
 EffectFlicker::EffectFlicker(uint8_t base_brightness, uint8_t flicker_depth, uint8_t flicker_speed)
     : _base_brightness(base_brightness), _flicker_depth(flicker_depth), _flicker_speed(flicker_speed),
-      _noise_position(random16()), _noise_increment(0) {
+      _noise_position(_random.random16()), _noise_increment(0) {
     // Map speed 0-255 to a reasonable noise increment step
     // FastLED noise usually works well with steps of 10-100 per frame
     _noise_increment = map(flicker_speed, 0, 255, 5, 100);
 }
 
+void EffectFlicker::attachClock(const EffectClock* clock, uint16_t stream) {
+    Effect::attachClock(clock, stream);
+    _noise_position = _random.random16();
+}
+
 void EffectFlicker::update(uint32_t delta_ms, const std::vector<PhysicalOutput*>& outputs) {
     if (!_is_active) {
         for (auto* output : outputs) output->setValue(0);
@@ -77,6 +87,7 @@ EffectStrobe::EffectStrobe(uint16_t strobe_frequency_hz, uint8_t duty_cycle_perc
     : _brightness(brightness), _timer(0) {
     if (strobe_frequency_hz == 0) strobe_frequency_hz = 1;
     _strobe_period_ms = 1000 / strobe_frequency_hz;
+    if (_strobe_period_ms == 0) _strobe_period_ms = 1;
     _on_time_ms = (_strobe_period_ms * constrain(duty_cycle_percent, 0, 100)) / 100;
 }
 
@@ -103,6 +114,12 @@ void EffectStrobe::update(uint32_t delta_ms, const std::vector<PhysicalOutput*>&
     }
 }
 
+uint32_t EffectStrobe::nextUpdateMs() const {
+    if (!_is_active) return UPDATE_IDLE;
+    // Sleep until the next on/off edge
+    return (_timer < _on_time_ms) ? _on_time_ms - _timer : _strobe_period_ms - _timer;
+}
+
 // Refactored EffectMarsLight to use FastLED beatsin8 / sin8
 EffectMarsLight::EffectMarsLight(uint16_t oscillation_frequency_mhz, uint8_t peak_brightness, int8_t phase_shift_percent)
     : _peak_brightness(peak_brightness) {
@@ -123,16 +140,13 @@ void EffectMarsLight::update(uint32_t delta_ms, const std::vector<PhysicalOutput
         return;
     }
 
-    // beatsin8 returns a value oscillating between low and high
-    // We want 0 to peak_brightness
-    // beatsin8(bpm, low, high, timebase, phase_offset)
-    // We use millis() as timebase.
-
-    // Note: beatsin8 auto-calculates based on millis().
-    // If we need exact phase sync across multiple effects, they rely on the same millis().
-    // The phase_offset allows the shift.
-
-    uint8_t value = beatsin8(_bpm, 0, _peak_brightness, 0, _phase_shift);
+    // beatsin8(_bpm, 0, _peak_brightness, 0, _phase_shift), on the controller's clock rather
+    // than millis(). Mars lights of one controller share that clock, so the phase offset
+    // keeps them in step.
+    _local_ms += delta_ms;
+    uint32_t now_ms = _clock ? _clock->nowMs() : _local_ms;
+    uint8_t beat = (uint8_t)((now_ms * ((uint32_t)_bpm << 8) * 280) >> 24);
+    uint8_t value = scale8(sin8((uint8_t)(beat + _phase_shift)), _peak_brightness);
 
     for (auto* output : outputs) {
         output->setValue(value);
@@ -185,14 +199,19 @@ void EffectSoftStartStop::update(uint32_t delta_ms, const std::vector<PhysicalOu
         }
     }
 
-    // Output value is the high byte
-    uint8_t value = (uint8_t)(_current_brightness >> 8);
+    // Scale 8.8 to 16 bits (0xFF00 -> 0xFFFF) so the fraction reaches the output.
+    uint16_t value = (uint16_t)(_current_brightness + (_current_brightness >> 8));
 
     for (auto* output : outputs) {
-        output->setValue(value);
+        output->setValue16(value);
     }
 }
 
+uint32_t EffectSoftStartStop::nextUpdateMs() const {
+    uint32_t target_fixed = _is_active ? ((uint32_t)_target_brightness) << 8 : 0;
+    return (_current_brightness != target_fixed) ? UPDATE_NEXT_TICK : UPDATE_IDLE;
+}
+
 EffectServo::EffectServo(uint8_t endpoint_a, uint8_t endpoint_b, uint8_t travel_speed)
     : _endpoint_a(endpoint_a), _endpoint_b(endpoint_b), _current_angle((uint16_t)endpoint_a << 8), _target_angle((uint16_t)endpoint_a << 8) {
 
@@ -290,7 +309,7 @@ void EffectFire::update(uint32_t delta_ms, const std::vector<PhysicalOutput*>& o
         // we should scale the cooling.
         // Original: random(0, ((cooling * 10) / NUM_LEDS) + 2)
         // We simplify for this demo:
-        uint8_t cooldown = random8(0, ((_cooling * 10) / _length) + 2);
+        uint8_t cooldown = _random.random8(0, ((_cooling * 10) / _length) + 2);
         if(cooldown > _heat[i]) {
             _heat[i] = 0;
         } else {
@@ -304,9 +323,9 @@ void EffectFire::update(uint32_t delta_ms, const std::vector<PhysicalOutput*>& o
     }
 
     // Step 3.  Randomly ignite new 'sparks' near the bottom
-    if( random8() < _sparking ) {
-        int y = random8(std::min((int)_length, 7));
-        _heat[y] = qadd8( _heat[y], random8(160,255) );
+    if( _random.random8() < _sparking ) {
+        int y = _random.random8(std::min((int)_length, 7));
+        _heat[y] = qadd8( _heat[y], _random.random8(160,255) );
     }
 
     // Step 4.  Map from heat cells to LED colors (or just brightness for now)
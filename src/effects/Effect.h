@@ -2,6 +2,8 @@
 #define EFFECT_H
 
 #include "../PhysicalOutput.h"
+#include "../Scheduling.h"
+#include "EffectClock.h"
 #include <vector>
 #include <cstdint>
 #include <FastLED.h>
@@ -16,15 +18,32 @@ public:
     virtual bool isActive() const { return _is_active; }
     virtual void setDimmed(bool dimmed) {}
     virtual bool isDimmed() const { return false; }
+    /**
+     * @brief Milliseconds until update() must run again, given the state it left behind.
+     *
+     * UPDATE_IDLE means the outputs only change on setActive()/setDimmed(). The default
+     * asks for every tick, which is always correct but never lets the controller idle.
+     */
+    virtual uint32_t nextUpdateMs() const { return UPDATE_NEXT_TICK; }
+    /**
+     * @brief Connects the effect to its controller's clock and gives it its random stream.
+     *
+     * Effects read time and randomness only from these, never from millis() or a global
+     * generator. A detached effect counts its own update() time and uses stream 0.
+     */
+    virtual void attachClock(const EffectClock* clock, uint16_t stream);
 
 protected:
     bool _is_active = false;
+    const EffectClock* _clock = nullptr;
+    EffectRandom _random;
 };
 
 class EffectSteady : public Effect {
 public:
     EffectSteady(uint8_t brightness);
     void update(uint32_t delta_ms, const std::vector<PhysicalOutput*>& outputs) override;
+    uint32_t nextUpdateMs() const override { return UPDATE_IDLE; }
 private:
     uint8_t _brightness;
 };
@@ -35,6 +54,7 @@ public:
     void update(uint32_t delta_ms, const std::vector<PhysicalOutput*>& outputs) override;
     void setDimmed(bool dimmed) override;
     bool isDimmed() const override { return _is_dimmed; }
+    uint32_t nextUpdateMs() const override { return UPDATE_IDLE; }
 private:
     uint8_t _brightness_full;
     uint8_t _brightness_dimmed;
@@ -45,6 +65,8 @@ class EffectFlicker : public Effect {
 public:
     EffectFlicker(uint8_t base_brightness, uint8_t flicker_depth, uint8_t flicker_speed);
     void update(uint32_t delta_ms, const std::vector<PhysicalOutput*>& outputs) override;
+    uint32_t nextUpdateMs() const override { return _is_active ? UPDATE_NEXT_TICK : UPDATE_IDLE; }
+    void attachClock(const EffectClock* clock, uint16_t stream) override;
 private:
     uint8_t _base_brightness;
     uint8_t _flicker_depth;
@@ -58,6 +80,7 @@ public:
     EffectStrobe(uint16_t strobe_frequency_hz, uint8_t duty_cycle_percent, uint8_t brightness);
     void update(uint32_t delta_ms, const std::vector<PhysicalOutput*>& outputs) override;
     void setActive(bool active) override;
+    uint32_t nextUpdateMs() const override;
 private:
     uint32_t _strobe_period_ms;
     uint32_t _on_time_ms;
@@ -69,10 +92,12 @@ class EffectMarsLight : public Effect {
 public:
     EffectMarsLight(uint16_t oscillation_frequency_mhz, uint8_t peak_brightness, int8_t phase_shift_percent);
     void update(uint32_t delta_ms, const std::vector<PhysicalOutput*>& outputs) override;
+    uint32_t nextUpdateMs() const override { return _is_active ? UPDATE_NEXT_TICK : UPDATE_IDLE; }
 private:
     uint8_t _bpm; // Beats per minute, derived from frequency
     uint8_t _peak_brightness;
     uint8_t _phase_shift; // 0-255
+    uint32_t _local_ms = 0; // Own time while detached from a controller
 };
 
 class EffectSoftStartStop : public Effect {
@@ -80,6 +105,7 @@ public:
     EffectSoftStartStop(uint16_t fade_in_time_ms, uint16_t fade_out_time_ms, uint8_t target_brightness);
     void update(uint32_t delta_ms, const std::vector<PhysicalOutput*>& outputs) override;
     void setActive(bool active) override;
+    uint32_t nextUpdateMs() const override;
 private:
     uint16_t _fade_in_time_ms;
     uint16_t _fade_out_time_ms;
@@ -93,6 +119,7 @@ public:
     EffectServo(uint8_t endpoint_a, uint8_t endpoint_b, uint8_t travel_speed);
     void update(uint32_t delta_ms, const std::vector<PhysicalOutput*>& outputs) override;
     void setActive(bool active) override;
+    uint32_t nextUpdateMs() const override { return _current_angle != _target_angle ? UPDATE_NEXT_TICK : UPDATE_IDLE; }
 private:
     uint8_t _endpoint_a;
     uint8_t _endpoint_b;
@@ -106,6 +133,7 @@ class EffectSmokeGenerator : public Effect {
 public:
     EffectSmokeGenerator(bool heater_enabled, uint8_t fan_speed);
     void update(uint32_t delta_ms, const std::vector<PhysicalOutput*>& outputs) override;
+    uint32_t nextUpdateMs() const override { return UPDATE_IDLE; }
 private:
     bool _heater_enabled;
     uint8_t _fan_speed;
@@ -122,6 +150,7 @@ public:
     EffectFire& operator=(const EffectFire&) = delete;
 
     void update(uint32_t delta_ms, const std::vector<PhysicalOutput*>& outputs) override;
+    uint32_t nextUpdateMs() const override { return _is_active ? UPDATE_NEXT_TICK : UPDATE_IDLE; }
 private:
     uint8_t _cooling;
     uint8_t _sparking;
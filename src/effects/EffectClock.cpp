@@ -0,0 +1,23 @@
+#include "EffectClock.h"
+
+namespace xDuinoRails {
+
+void EffectRandom::reseed(uint32_t seed, uint16_t stream) {
+    // Mix the stream into the seed (murmur3 finalizer) so neighbouring streams are unrelated.
+    uint32_t h = seed ^ ((uint32_t)stream * 0x9E3779B9u);
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    _state = h ? h : 1; // xorshift never leaves 0
+}
+
+uint16_t EffectRandom::random16() {
+    _state ^= _state << 13;
+    _state ^= _state >> 17;
+    _state ^= _state << 5;
+    return (uint16_t)(_state >> 16);
+}
+
+}
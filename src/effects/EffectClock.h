@@ -0,0 +1,47 @@
+#ifndef EFFECTCLOCK_H
+#define EFFECTCLOCK_H
+
+#include <cstdint>
+
+namespace xDuinoRails {
+
+/**
+ * @brief The time base and random seed shared by the effects of one AuxController.
+ *
+ * Time only moves when the controller's update() is given a delta, so a simulation can
+ * run hours of layout time in milliseconds and replay the same output bit for bit.
+ */
+class EffectClock {
+public:
+    /** @brief Milliseconds of update() deltas since the controller was created. */
+    uint32_t nowMs() const { return _now_ms; }
+    void advance(uint32_t delta_ms) { _now_ms += delta_ms; }
+    uint32_t seed() const { return _seed; }
+    void setSeed(uint32_t seed) { _seed = seed; }
+
+private:
+    uint32_t _now_ms = 0;
+    uint32_t _seed = 0x2545F491;
+};
+
+/** @brief A deterministic random stream (xorshift32), one per effect. */
+class EffectRandom {
+public:
+    explicit EffectRandom(uint32_t seed = 0, uint16_t stream = 0) { reseed(seed, stream); }
+
+    /** @brief Restarts the stream; every (seed, stream) pair gives its own sequence. */
+    void reseed(uint32_t seed, uint16_t stream);
+    uint16_t random16();
+    uint8_t random8() { return (uint8_t)(random16() >> 8); }
+    /** @brief A value in [0, lim). */
+    uint8_t random8(uint8_t lim) { return (uint8_t)(((uint16_t)random8() * lim) >> 8); }
+    /** @brief A value in [min, lim). */
+    uint8_t random8(uint8_t min, uint8_t lim) { return (uint8_t)(min + random8((uint8_t)(lim - min))); }
+
+private:
+    uint32_t _state;
+};
+
+}
+
+#endif // EFFECTCLOCK_H
@@ -2,6 +2,7 @@
 #define ICVACCESS_H
 
 #include <cstdint>
+#include "../cv_definitions.h"
 
 namespace xDuinoRails {
 
@@ -10,6 +11,35 @@ public:
     virtual ~ICVAccess() {}
     virtual uint8_t readCV(uint16_t cv_number) = 0;
     virtual void writeCV(uint16_t cv_number, uint8_t value) = 0;
+
+    /**
+     * @brief Reads `count` consecutive CVs starting at `first_cv` into `buffer`.
+     *
+     * CVs in the indexed window (257-512) are read from `page` (CV31 = high byte, CV32 = low
+     * byte); `page` is ignored for other CVs. The default selects the page, writing CV31/CV32
+     * only if they differ, and falls back to readCV(). The page stays selected afterwards.
+     * Backends that can read a block without switching pages (EEPROM, RAM) should override it.
+     */
+    virtual void readCVs(uint16_t page, uint16_t first_cv, uint16_t count, uint8_t* buffer) {
+        if (first_cv + count > CV_INDEXED_WINDOW_START && first_cv < CV_INDEXED_WINDOW_START + CV_INDEXED_WINDOW_SIZE) {
+            uint8_t high = (uint8_t)(page >> 8);
+            uint8_t low = (uint8_t)page;
+            if (readCV(CV_INDEXED_CV_HIGH_BYTE) != high) writeCV(CV_INDEXED_CV_HIGH_BYTE, high);
+            if (readCV(CV_INDEXED_CV_LOW_BYTE) != low) writeCV(CV_INDEXED_CV_LOW_BYTE, low);
+        }
+        for (uint16_t i = 0; i < count; ++i) {
+            buffer[i] = readCV(first_cv + i);
+        }
+    }
+
+    /**
+     * @brief A counter that changes whenever a stored CV changes and survives power cycles.
+     *
+     * AuxController::loadFromImage() trusts an image saved at the same count without reading
+     * the mapping pages back. Backends that keep no such counter return 0 (the default); images
+     * are then checked against a hash of the CVs.
+     */
+    virtual uint32_t changeCounter() { return 0; }
 };
 
 }
@@ -0,0 +1,26 @@
+#ifndef IMAPPINGIMAGESOURCE_H
+#define IMAPPINGIMAGESOURCE_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace xDuinoRails {
+
+/**
+ * @brief Storage a mapping image is loaded from, e.g. EEPROM or flash.
+ *
+ * AuxController::loadFromImage() reads the image front to back in small blocks, once to check
+ * the payload hash and once to decode it, so the image never has to be copied into RAM.
+ */
+class IMappingImageSource {
+public:
+    virtual ~IMappingImageSource() {}
+    /** @brief Size of the stored image in bytes. */
+    virtual size_t size() = 0;
+    /** @brief Copies `count` bytes starting at `offset` into `buffer`; never reads past size(). */
+    virtual void read(size_t offset, uint8_t* buffer, size_t count) = 0;
+};
+
+}
+
+#endif // IMAPPINGIMAGESOURCE_H
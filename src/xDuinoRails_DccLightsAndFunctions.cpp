@@ -5,6 +5,7 @@
 #include "xDuinoRails_DccLightsAndFunctions.h"
 #include "cv_definitions.h"
 #include <math.h>
+#include <algorithm>
 #include "effects/Effect.h"
 #include "LightSources/SingleLed.h"
 
@@ -32,76 +33,523 @@ void AuxController::addLightSource(std::unique_ptr<LightSource> lightSource) {
     _outputs.back().begin();
 }
 
-void AuxController::update(uint32_t delta_ms) {
+void AuxController::setCombineMode(uint8_t id, CombineMode mode) {
+    PhysicalOutput* output = getOutputById(id);
+    if (output) output->setCombineMode(mode);
+}
+
+void AuxController::setBrightnessCurve(uint8_t id, BrightnessCurve curve) {
+    PhysicalOutput* output = getOutputById(id);
+    if (output) output->setBrightnessCurve(curve);
+}
+
+uint32_t AuxController::update(uint32_t delta_ms) {
+    _clock.advance(delta_ms);
+    if (_standby_ready) activateStandby();
     if (_state_changed) {
         _state_changed = false;
         evaluateMapping();
     }
+    uint32_t next_update_ms = UPDATE_IDLE;
     for (auto& func : _logical_functions) {
-        func->update(delta_ms);
+        next_update_ms = std::min(next_update_ms, func->update(delta_ms));
+    }
+    for (auto& output : _outputs) {
+        next_update_ms = std::min(next_update_ms, output.update(delta_ms));
+    }
+    // Effects only buffer their levels; write every output before transmitting any, so
+    // outputs sharing a strip are sent once per update. A dithering output asks for another
+    // update to write its settled level.
+    for (auto& output : _outputs) {
+        next_update_ms = std::min(next_update_ms, output.render());
     }
     for (auto& output : _outputs) {
-        output.update(delta_ms);
+        output.commit();
     }
+    // Logical function states that did not settle within this update are evaluated on the next.
+    return _state_changed ? UPDATE_NEXT_TICK : next_update_ms;
 }
 
 void AuxController::loadFromCVs(ICVAccess& cvAccess) {
-    reset();
-    auto mapping_method = static_cast<FunctionMappingMethod>(cvAccess.readCV(CV_FUNCTION_MAPPING_METHOD));
-    switch (mapping_method) {
+    // Fetch every page once up front; the parsers only look at these buffers.
+    uint8_t effects[CV_INDEXED_WINDOW_SIZE];
+    uint8_t mapping[CV_INDEXED_WINDOW_SIZE];
+    FunctionMappingMethod mapping_method;
+    uint32_t source_key = readMappingSource(cvAccess, mapping_method, mapping, effects);
+
+    beginStandby();
+    _source_key = source_key;
+    _mapping_method = mapping_method;
+    uint8_t num_outputs = mappingOutputCount(mapping_method);
+    for (uint8_t output_num = 1; output_num <= num_outputs; ++output_num) {
+        parseOutput(mapping, effects, output_num);
+    }
+    compileMapping();
+    swapMapping(_standby);
+    _standby_ready = true;
+}
+
+void AuxController::reloadCV(ICVAccess& cvAccess, uint16_t page, uint16_t cv_number) {
+    uint8_t effects[CV_INDEXED_WINDOW_SIZE];
+    uint8_t mapping[CV_INDEXED_WINDOW_SIZE];
+    FunctionMappingMethod mapping_method;
+    uint32_t source_key = readMappingSource(cvAccess, mapping_method, mapping, effects);
+    if (_standby_ready) activateStandby();
+    if (source_key == _source_key && mapping_method == _mapping_method) return; // Not a mapping CV, or unchanged
+
+    uint32_t outputs = 0;
+    bool in_window = cv_number >= CV_INDEXED_WINDOW_START && cv_number < CV_INDEXED_WINDOW_START + CV_INDEXED_WINDOW_SIZE;
+    if (mapping_method == _mapping_method && in_window && page == EFFECTS_BLOCK_PAGE) {
+        // Only the effect changed; swap it in under the running logical functions.
+        uint8_t output_num = (cv_number - CV_INDEXED_WINDOW_START) / EFFECTS_BLOCK_CV_PER_OUTPUT + 1;
+        for (uint8_t i = 0; i < _logical_functions.size(); ++i) {
+            if (_lf_outputs[i] != output_num) continue;
+            const uint8_t* effect_cvs = effects + (output_num - 1) * EFFECTS_BLOCK_CV_PER_OUTPUT;
+            _logical_functions[i]->setEffect(createEffect(effect_cvs));
+            _lf_effect_keys[i] = mappingImageHash(effect_cvs, EFFECTS_BLOCK_CV_PER_OUTPUT);
+        }
+        _source_key = source_key;
+        return;
+    }
+    if (mapping_method == _mapping_method) outputs = outputsAffectedBy(mapping, page, cv_number);
+
+    if (outputs == 0) {
+        // The mapping method changed (or the write is not understood): rebuild every output.
+        loadFromCVs(cvAccess);
+        return;
+    }
+
+    _source_key = source_key;
+    decompileRules();
+    for (uint8_t output_num = 1; output_num <= 32; ++output_num) {
+        if ((outputs >> (output_num - 1)) & 1) rebuildOutput(mapping, effects, output_num);
+    }
+    compileMapping();
+}
+
+uint32_t AuxController::outputsAffectedBy(const uint8_t* mapping, uint16_t page, uint16_t cv_number) const {
+    // Returns a mask with bit n-1 set for every output n whose logical functions depend on the CV,
+    // under the old mapping or the new one.
+    bool in_window = cv_number >= CV_INDEXED_WINDOW_START && cv_number < CV_INDEXED_WINDOW_START + CV_INDEXED_WINDOW_SIZE;
+    uint16_t offset = cv_number - CV_INDEXED_WINDOW_START;
+    uint16_t expected_page = 0;
+    switch (_mapping_method) {
+        case FunctionMappingMethod::RCN_225: {
+            if (cv_number < CV_OUTPUT_LOCATION_CONFIG_START || cv_number > CV_OUTPUT_LOCATION_CONFIG_END) return 0;
+            uint8_t i = cv_number - CV_OUTPUT_LOCATION_CONFIG_START;
+            uint32_t forward = (i == 1) ? 0 : (i == 0) ? 1 : (uint32_t)1 << (i - 1);
+            uint32_t reverse = (i == 0) ? 0 : (i == 1) ? 1 : (uint32_t)1 << (i - 1);
+            return mapping[i] | outputsWithMaskTerm(forward, reverse);
+        }
+        case FunctionMappingMethod::RCN_227_PER_FUNCTION: {
+            if (!in_window || page != RCN227_PER_FUNCTION_PAGE) return 0;
+            uint8_t group = offset / 4;
+            if (group >= 64) return 0;
+            const uint8_t* base_cv = mapping + group * 4;
+            uint32_t output_mask = (uint32_t)base_cv[2] << 16 | (uint32_t)base_cv[1] << 8 | base_cv[0];
+            uint32_t func_bit = (uint32_t)1 << (group / 2);
+            bool forward = (group % 2) == 0;
+            return output_mask | outputsWithMaskTerm(forward ? func_bit : 0, forward ? 0 : func_bit);
+        }
+        case FunctionMappingMethod::RCN_227_PER_OUTPUT_V1: expected_page = RCN227_PER_OUTPUT_V1_PAGE; break;
+        case FunctionMappingMethod::RCN_227_PER_OUTPUT_V2: expected_page = RCN227_PER_OUTPUT_V2_PAGE; break;
+        case FunctionMappingMethod::RCN_227_PER_OUTPUT_V3: expected_page = RCN227_PER_OUTPUT_V3_PAGE; break;
+        default: return 0;
+    }
+    // The per-output methods use eight CVs per output.
+    if (!in_window || page != expected_page) return 0;
+    uint8_t output_num = offset / 8 + 1;
+    return (output_num <= mappingOutputCount(_mapping_method)) ? (uint32_t)1 << (output_num - 1) : 0;
+}
+
+uint32_t AuxController::outputsWithMaskTerm(uint32_t forward_mask, uint32_t reverse_mask) const {
+    // Outputs with a term activated by any of the given functions.
+    uint32_t outputs = 0;
+    for (const auto& term : _mask_terms) {
+        if (!(term.function_mask[DECODER_DIRECTION_FORWARD] & forward_mask) && !(term.function_mask[DECODER_DIRECTION_REVERSE] & reverse_mask)) continue;
+        if (term.target_logical_function_id < _lf_outputs.size()) {
+            outputs |= (uint32_t)1 << (_lf_outputs[term.target_logical_function_id] - 1);
+        }
+    }
+    return outputs;
+}
+
+void AuxController::decompileRules() {
+    // Turn compiled masks back into ConditionVariable ids so compileMapping() can renumber
+    // the conditions after some are removed. The spare bit maps to an id no parser uses.
+    for (auto& rule : _mapping_rules) {
+        if (!rule.positive_conditions.empty() || !rule.negative_conditions.empty()) continue;
+        for (int negative = 0; negative < 2; ++negative) {
+            const auto& masks = negative ? rule.negative_mask : rule.positive_mask;
+            auto& ids = negative ? rule.negative_conditions : rule.positive_conditions;
+            for (const auto& mask : masks) {
+                for (uint8_t bit = 0; bit < 32; ++bit) {
+                    if (!((mask.bits >> bit) & 1)) continue;
+                    uint16_t index = (mask.word << 5) + bit;
+                    ids.push_back(index < _condition_variables.size() ? _condition_variables[index].id : 0xFFFF);
+                }
+            }
+        }
+    }
+}
+
+void AuxController::rebuildOutput(const uint8_t* mapping, const uint8_t* effects, uint8_t output_num) {
+    _reuse_slots.clear();
+    for (uint8_t i = 0; i < _lf_outputs.size(); ++i) {
+        if (_lf_outputs[i] == output_num) _reuse_slots.push_back(i);
+    }
+    auto drives_output = [&](uint8_t target) { return target < _lf_outputs.size() && _lf_outputs[target] == output_num; };
+    _mapping_rules.erase(std::remove_if(_mapping_rules.begin(), _mapping_rules.end(),
+                                        [&](const MappingRule& rule) { return drives_output(rule.target_logical_function_id); }),
+                         _mapping_rules.end());
+    _mask_terms.erase(std::remove_if(_mask_terms.begin(), _mask_terms.end(),
+                                     [&](const FunctionMaskTerm& term) { return drives_output(term.target_logical_function_id); }),
+                      _mask_terms.end());
+
+    // Drop the conditions only the removed rules used, so the re-parsed ones replace them.
+    std::vector<uint16_t> used;
+    for (const auto& rule : _mapping_rules) {
+        used.insert(used.end(), rule.positive_conditions.begin(), rule.positive_conditions.end());
+        used.insert(used.end(), rule.negative_conditions.begin(), rule.negative_conditions.end());
+    }
+    std::sort(used.begin(), used.end());
+    _condition_variables.erase(std::remove_if(_condition_variables.begin(), _condition_variables.end(),
+                                              [&](const ConditionVariable& cv) { return !std::binary_search(used.begin(), used.end(), cv.id); }),
+                               _condition_variables.end());
+    rebuildConditionTable();
+
+    // The parser reuses this output's logical functions (and their running effects) in order.
+    std::reverse(_reuse_slots.begin(), _reuse_slots.end());
+    parseOutput(mapping, effects, output_num);
+    for (uint8_t slot : _reuse_slots) removeLogicalFunction(slot); // Highest slot first
+    _reuse_slots.clear();
+
+    _mask_term_inputs = 0;
+    for (const auto& term : _mask_terms) _mask_term_inputs |= term.inputs();
+}
+
+void AuxController::removeLogicalFunction(uint8_t index) {
+    delete _logical_functions[index];
+    _logical_functions.erase(_logical_functions.begin() + index);
+    _lf_outputs.erase(_lf_outputs.begin() + index);
+    _lf_effect_keys.erase(_lf_effect_keys.begin() + index);
+    for (auto& rule : _mapping_rules) {
+        if (rule.target_logical_function_id > index) --rule.target_logical_function_id;
+    }
+    for (auto& term : _mask_terms) {
+        if (term.target_logical_function_id > index) --term.target_logical_function_id;
+    }
+    for (auto& cv : _condition_variables) {
+        for (auto& condition : cv.conditions) {
+            if (condition.source == TriggerSource::LOGICAL_FUNC_STATE && condition.parameter > index) --condition.parameter;
+        }
+    }
+}
+
+uint8_t AuxController::mappingOutputCount(FunctionMappingMethod method) {
+    switch (method) {
+        case FunctionMappingMethod::RCN_225: return 8;
+        case FunctionMappingMethod::RCN_227_PER_FUNCTION: return 24;
+        case FunctionMappingMethod::RCN_227_PER_OUTPUT_V1: return 24;
+        case FunctionMappingMethod::RCN_227_PER_OUTPUT_V2: return 32;
+        case FunctionMappingMethod::RCN_227_PER_OUTPUT_V3: return 32;
+        default: return 0;
+    }
+}
+
+void AuxController::parseOutput(const uint8_t* mapping, const uint8_t* effects, uint8_t output_num) {
+    switch (_mapping_method) {
         case FunctionMappingMethod::RCN_225:
-            parseRcn225(cvAccess);
+            parseRcn225(mapping, effects, output_num);
             break;
         // Note: RCN-227 "per-function" is implemented for completeness but is not the recommended approach.
         // The "per-output" methods below offer greater flexibility.
         case FunctionMappingMethod::RCN_227_PER_FUNCTION:
-            parseRcn227PerFunction(cvAccess);
+            parseRcn227PerFunction(mapping, effects, output_num);
             break;
         case FunctionMappingMethod::RCN_227_PER_OUTPUT_V1:
-            parseRcn227PerOutputV1(cvAccess);
+            parseRcn227PerOutputV1(mapping, effects, output_num);
             break;
         case FunctionMappingMethod::RCN_227_PER_OUTPUT_V2:
-            parseRcn227PerOutputV2(cvAccess);
+            parseRcn227PerOutputV2(mapping, effects, output_num);
+            break;
+        case FunctionMappingMethod::RCN_227_PER_OUTPUT_V3:
+            parseRcn227PerOutputV3(mapping, effects, output_num);
             break;
         case FunctionMappingMethod::PROPRIETARY:
         default:
-            return;
-        case FunctionMappingMethod::RCN_227_PER_OUTPUT_V3:
-            parseRcn227PerOutputV3(cvAccess);
             break;
     }
 }
 
+uint32_t AuxController::readMappingSource(ICVAccess& cvAccess, FunctionMappingMethod& method, uint8_t* mapping, uint8_t* effects) {
+    uint8_t method_cv = cvAccess.readCV(CV_FUNCTION_MAPPING_METHOD);
+    method = static_cast<FunctionMappingMethod>(method_cv);
+    uint16_t page = 0;
+    switch (method) {
+        case FunctionMappingMethod::RCN_225: page = 0; break;
+        case FunctionMappingMethod::RCN_227_PER_FUNCTION: page = RCN227_PER_FUNCTION_PAGE; break;
+        case FunctionMappingMethod::RCN_227_PER_OUTPUT_V1: page = RCN227_PER_OUTPUT_V1_PAGE; break;
+        case FunctionMappingMethod::RCN_227_PER_OUTPUT_V2: page = RCN227_PER_OUTPUT_V2_PAGE; break;
+        case FunctionMappingMethod::RCN_227_PER_OUTPUT_V3: page = RCN227_PER_OUTPUT_V3_PAGE; break;
+        default: return mappingImageHash(&method_cv, 1);
+    }
+    cvAccess.readCVs(EFFECTS_BLOCK_PAGE, CV_INDEXED_WINDOW_START, CV_INDEXED_WINDOW_SIZE, effects);
+    uint16_t mapping_size = CV_INDEXED_WINDOW_SIZE;
+    if (method == FunctionMappingMethod::RCN_225) {
+        mapping_size = CV_OUTPUT_LOCATION_CONFIG_END - CV_OUTPUT_LOCATION_CONFIG_START + 1;
+        cvAccess.readCVs(0, CV_OUTPUT_LOCATION_CONFIG_START, mapping_size, mapping);
+    } else {
+        cvAccess.readCVs(page, CV_INDEXED_WINDOW_START, mapping_size, mapping);
+    }
+    uint32_t key = mappingImageHash(&method_cv, 1);
+    key = mappingImageHash(mapping, mapping_size, key);
+    return mappingImageHash(effects, CV_INDEXED_WINDOW_SIZE, key);
+}
+
+bool AuxController::saveMappingImage(ICVAccess& cvAccess, std::vector<uint8_t>& image) {
+    static_assert(EFFECTS_BLOCK_CV_PER_OUTPUT <= 8, "The image marks the stored effect CVs in one byte");
+    if (_standby_ready) activateStandby();
+    image.clear();
+    uint8_t effects[CV_INDEXED_WINDOW_SIZE];
+    uint8_t mapping[CV_INDEXED_WINDOW_SIZE];
+    FunctionMappingMethod mapping_method;
+    uint32_t counter = cvAccess.changeCounter();
+    uint32_t key = readMappingSource(cvAccess, mapping_method, mapping, effects);
+    if (key != _source_key || mapping_method != _mapping_method) return false;
+
+    MappingImageWriter out(image);
+    out.put8(MAPPING_IMAGE_MAGIC_0);
+    out.put8(MAPPING_IMAGE_MAGIC_1);
+    out.put8(MAPPING_IMAGE_VERSION);
+    out.put8((uint8_t)_mapping_method);
+    out.put32(_source_key);
+    out.put32(0); // Payload hash, filled in below
+    out.put32(counter);
+
+    out.put8((uint8_t)_lf_outputs.size());
+    for (uint8_t output_num : _lf_outputs) {
+        out.put8(output_num);
+        // Most effects use only some of their CVs; the unused ones are 0 and left out.
+        const uint8_t* effect_cvs = effects + (output_num - 1) * EFFECTS_BLOCK_CV_PER_OUTPUT;
+        uint8_t present = 0;
+        for (uint8_t i = 0; i < EFFECTS_BLOCK_CV_PER_OUTPUT; ++i) {
+            if (effect_cvs[i] != 0) present |= (uint8_t)(1 << i);
+        }
+        out.put8(present);
+        for (uint8_t i = 0; i < EFFECTS_BLOCK_CV_PER_OUTPUT; ++i) {
+            if (effect_cvs[i] != 0) out.put8(effect_cvs[i]);
+        }
+    }
+
+    out.put16((uint16_t)_condition_variables.size());
+    for (const auto& cv : _condition_variables) {
+        out.put16(cv.id);
+        out.put8((uint8_t)cv.conditions.size());
+        for (const auto& condition : cv.conditions) {
+            out.put8((uint8_t)condition.source);
+            out.put8((uint8_t)condition.comparator);
+            out.put8(condition.parameter);
+        }
+    }
+
+    // Rules refer to the conditions by their index in the list above, one byte wide if it can be.
+    bool wide_indices = _condition_variables.size() > 0xFF;
+    std::vector<uint16_t> indices;
+    out.put16((uint16_t)_mapping_rules.size());
+    for (const auto& rule : _mapping_rules) {
+        out.put8(rule.target_logical_function_id);
+        out.put8((uint8_t)rule.action);
+        for (const auto* masks : {&rule.positive_mask, &rule.negative_mask}) {
+            indices.clear();
+            for (const auto& mask : *masks) {
+                for (uint8_t bit = 0; bit < 32; ++bit) {
+                    if ((mask.bits >> bit) & 1) indices.push_back((mask.word << 5) + bit);
+                }
+            }
+            out.put8((uint8_t)indices.size());
+            for (uint16_t index : indices) {
+                if (wide_indices) out.put16(index); else out.put8((uint8_t)index);
+            }
+        }
+    }
+
+    // Group the terms by shape; every output of a bitmask mapping usually has the same ones.
+    std::vector<uint16_t> shapes; // Index of the first term of each shape
+    auto same_shape = [](const FunctionMaskTerm& a, const FunctionMaskTerm& b) {
+        return a.function_mask[0] == b.function_mask[0] && a.function_mask[1] == b.function_mask[1] &&
+               a.blocking_mask == b.blocking_mask;
+    };
+    for (uint16_t i = 0; i < _mask_terms.size(); ++i) {
+        bool known = false;
+        for (uint16_t first : shapes) known = known || same_shape(_mask_terms[first], _mask_terms[i]);
+        if (!known) shapes.push_back(i);
+    }
+    out.put16((uint16_t)_mask_terms.size());
+    out.put16((uint16_t)shapes.size());
+    size_t target_bytes = (_lf_outputs.size() + 7) / 8;
+    for (uint16_t first : shapes) {
+        const FunctionMaskTerm& shape = _mask_terms[first];
+        out.put32(shape.function_mask[0]);
+        out.put32(shape.function_mask[1]);
+        out.put32(shape.blocking_mask);
+        std::vector<uint8_t> targets(target_bytes, 0);
+        for (const auto& term : _mask_terms) {
+            uint8_t lf = term.target_logical_function_id;
+            if (same_shape(term, shape) && lf < _lf_outputs.size()) targets[lf >> 3] |= (uint8_t)(1 << (lf & 7));
+        }
+        for (uint8_t byte : targets) out.put8(byte);
+    }
+
+    uint32_t payload_hash = mappingImageHash(image.data() + MAPPING_IMAGE_HEADER_SIZE, image.size() - MAPPING_IMAGE_HEADER_SIZE);
+    for (int i = 0; i < 4; ++i) image[8 + i] = (uint8_t)(payload_hash >> (8 * i));
+    return true;
+}
+
+bool AuxController::loadFromImage(ICVAccess& cvAccess, const std::vector<uint8_t>& image) {
+    MemoryMappingImageSource source(image.data(), image.size());
+    return loadFromImage(cvAccess, source);
+}
+
+bool AuxController::loadFromImage(ICVAccess& cvAccess, IMappingImageSource& image) {
+    size_t image_size = image.size();
+    if (image_size < MAPPING_IMAGE_HEADER_SIZE) return false;
+    size_t payload_size = image_size - MAPPING_IMAGE_HEADER_SIZE;
+    MappingImageReader header(image, 0, MAPPING_IMAGE_HEADER_SIZE);
+    if (header.get8() != MAPPING_IMAGE_MAGIC_0 || header.get8() != MAPPING_IMAGE_MAGIC_1) return false;
+    if (header.get8() != MAPPING_IMAGE_VERSION) return false;
+    uint8_t method_cv = header.get8();
+    uint32_t source_key = header.get32();
+    uint32_t payload_hash = header.get32();
+    uint32_t image_counter = header.get32();
+    // Check the whole payload before decoding any of it.
+    if (mappingImageHash(image, MAPPING_IMAGE_HEADER_SIZE, payload_size) != payload_hash) return false;
+
+    // The image is only valid for the CVs it was compiled from. An unchanged change counter
+    // vouches for them; otherwise read them back and compare hashes.
+    uint8_t effects[CV_INDEXED_WINDOW_SIZE] = {};
+    uint32_t counter = cvAccess.changeCounter();
+    if (counter == 0 || counter != image_counter) {
+        uint8_t mapping[CV_INDEXED_WINDOW_SIZE];
+        FunctionMappingMethod current_method;
+        uint32_t current_key = readMappingSource(cvAccess, current_method, mapping, effects);
+        if (current_key != source_key || (uint8_t)current_method != method_cv) return false;
+    } else if (cvAccess.readCV(CV_FUNCTION_MAPPING_METHOD) != method_cv) {
+        return false;
+    }
+
+    beginStandby();
+    _source_key = source_key;
+    _mapping_method = static_cast<FunctionMappingMethod>(method_cv);
+    MappingImageReader in(image, MAPPING_IMAGE_HEADER_SIZE, payload_size);
+
+    uint8_t lf_count = in.get8();
+    for (uint8_t i = 0; i < lf_count && in.ok(); ++i) {
+        uint8_t output_num = in.get8();
+        if (output_num < 1 || output_num > CV_INDEXED_WINDOW_SIZE / EFFECTS_BLOCK_CV_PER_OUTPUT) break;
+        uint8_t* effect_cvs = effects + (output_num - 1) * EFFECTS_BLOCK_CV_PER_OUTPUT;
+        uint8_t present = in.get8();
+        for (uint8_t j = 0; j < EFFECTS_BLOCK_CV_PER_OUTPUT; ++j) effect_cvs[j] = ((present >> j) & 1) ? in.get8() : 0;
+        addLogicalFunctionForOutput(effects, output_num);
+    }
+
+    uint16_t condition_count = in.get16();
+    _condition_variables.reserve(condition_count);
+    for (uint16_t i = 0; i < condition_count && in.ok(); ++i) {
+        ConditionVariable cv;
+        cv.id = in.get16();
+        uint8_t n = in.get8();
+        cv.conditions.reserve(n);
+        for (uint8_t j = 0; j < n; ++j) {
+            Condition condition;
+            condition.source = static_cast<TriggerSource>(in.get8());
+            condition.comparator = static_cast<TriggerComparator>(in.get8());
+            condition.parameter = in.get8();
+            cv.conditions.push_back(condition);
+        }
+        _condition_variables.push_back(std::move(cv));
+    }
+
+    // Conditions are stored in dense order, so the stored indices compile straight to masks.
+    bool wide_indices = condition_count > 0xFF;
+    bool indices_valid = true;
+    std::vector<uint16_t> indices;
+    uint16_t rule_count = in.get16();
+    _mapping_rules.reserve(rule_count);
+    for (uint16_t i = 0; i < rule_count && in.ok(); ++i) {
+        MappingRule rule;
+        rule.target_logical_function_id = in.get8();
+        rule.action = static_cast<MappingAction>(in.get8());
+        for (auto* masks : {&rule.positive_mask, &rule.negative_mask}) {
+            uint8_t n = in.get8();
+            indices.clear();
+            for (uint8_t j = 0; j < n; ++j) {
+                uint16_t index = wide_indices ? in.get16() : in.get8();
+                indices_valid = indices_valid && index <= condition_count;
+                indices.push_back(index);
+            }
+            *masks = ConditionStateSet::makeMasks(indices);
+        }
+        _mapping_rules.push_back(std::move(rule));
+    }
+
+    uint16_t term_count = in.get16();
+    uint16_t shape_count = in.get16();
+    _mask_terms.reserve(term_count);
+    for (uint16_t i = 0; i < shape_count && in.ok(); ++i) {
+        FunctionMaskTerm term = {};
+        term.function_mask[0] = in.get32();
+        term.function_mask[1] = in.get32();
+        term.blocking_mask = in.get32();
+        for (uint16_t byte = 0; byte < (lf_count + 7) / 8; ++byte) {
+            uint8_t targets = in.get8();
+            for (uint8_t bit = 0; bit < 8; ++bit) {
+                if (!((targets >> bit) & 1)) continue;
+                term.target_logical_function_id = (uint8_t)(byte * 8 + bit);
+                addMaskTerm(term);
+            }
+        }
+    }
+
+    bool loaded = in.ok() && in.atEnd() && indices_valid && _logical_functions.size() == lf_count &&
+                  _mask_terms.size() == term_count;
+    if (loaded) compileMapping();
+    swapMapping(_standby);
+    if (loaded) _standby_ready = true; else releaseStandby();
+    return loaded;
+}
+
 void AuxController::setFunctionState(uint8_t functionNumber, bool functionState) {
-    if (functionNumber < MAX_DCC_FUNCTIONS && _function_states[functionNumber] != functionState) {
-        _function_states[functionNumber] = functionState;
-        _state_changed = true;
+    if (functionNumber < MAX_DCC_FUNCTIONS && getFunctionState(functionNumber) != functionState) {
+        uint32_t bit = (uint32_t)1 << functionNumber;
+        if (functionState) _function_states |= bit; else _function_states &= ~bit;
+        noteInputChanged(TriggerSource::FUNC_KEY, functionNumber);
     }
 }
 
 void AuxController::setDirection(DecoderDirection direction) {
     if (_direction != direction) {
         _direction = direction;
-        _state_changed = true;
+        noteInputChanged(TriggerSource::DIRECTION, 0);
     }
 }
 
 void AuxController::setSpeed(uint16_t speed) {
     if (_speed != speed) {
         _speed = speed;
-        _state_changed = true;
+        noteInputChanged(TriggerSource::SPEED, 0);
     }
 }
 
 void AuxController::setBinaryState(uint16_t state_number, bool value) {
     if (m_binary_states.find(state_number) == m_binary_states.end() || m_binary_states[state_number] != value) {
         m_binary_states[state_number] = value;
-        _state_changed = true;
+        if (state_number <= 0xFF) noteInputChanged(TriggerSource::BINARY_STATE, (uint8_t)state_number);
     }
 }
 
 bool AuxController::getFunctionState(uint8_t functionNumber) const {
-    return (functionNumber < MAX_DCC_FUNCTIONS) ? _function_states[functionNumber] : false;
+    return (functionNumber < MAX_DCC_FUNCTIONS) ? ((_function_states >> functionNumber) & 1) : false;
 }
 
 DecoderDirection AuxController::getDirection() const {
@@ -113,8 +561,8 @@ uint16_t AuxController::getSpeed() const {
 }
 
 bool AuxController::getConditionVariableState(uint16_t cv_id) const {
-    auto it = _cv_states.find(cv_id);
-    return (it != _cv_states.end()) ? it->second : false;
+    uint16_t index = findConditionIndex(cv_id);
+    return (index < _condition_variables.size()) ? _cv_states.test(index) : false;
 }
 
 bool AuxController::getBinaryState(uint16_t state_number) const {
@@ -130,251 +578,542 @@ const LogicalFunction* AuxController::getLogicalFunction(size_t index) const {
     return (index < _logical_functions.size()) ? _logical_functions[index] : nullptr;
 }
 
+uint32_t AuxController::getElidedWriteCount() const {
+    uint32_t count = 0;
+    for (const auto& output : _outputs) count += output.getElidedWriteCount();
+    return count;
+}
+
+void AuxController::forceFullEvaluation() {
+    _evaluate_all = true;
+    _state_changed = true;
+}
+
 void AuxController::addLogicalFunction(LogicalFunction* function) {
+    // The slot index names the random stream, so the same configuration replays the same effects.
+    function->attachClock(&_clock, _logical_functions.size());
     _logical_functions.push_back(function);
 }
 
-void AuxController::addConditionVariable(const ConditionVariable& cv) {
+void AuxController::setRandomSeed(uint32_t seed) {
+    _clock.setSeed(seed);
+    for (size_t i = 0; i < _logical_functions.size(); ++i) _logical_functions[i]->attachClock(&_clock, i);
+    if (_standby_ready) {
+        // A mapping loaded but not yet swapped in renders with the new seed too.
+        auto& standby = _standby.logical_functions;
+        for (size_t i = 0; i < standby.size(); ++i) standby[i]->attachClock(&_clock, i);
+    }
+}
+
+uint16_t AuxController::addConditionVariable(const ConditionVariable& cv) {
+    // Identical predicates share one ConditionVariable, so each is evaluated once.
+    uint32_t hash = cv.predicateHash();
+    auto it = std::lower_bound(_condition_table.begin(), _condition_table.end(), std::make_pair(hash, (uint16_t)0));
+    for (; it != _condition_table.end() && it->first == hash; ++it) {
+        const ConditionVariable& existing = _condition_variables[it->second];
+        if (existing.samePredicate(cv)) return existing.id;
+    }
+    _condition_table.insert(it, std::make_pair(hash, (uint16_t)_condition_variables.size()));
     _condition_variables.push_back(cv);
+    // Other outputs' rules may already use this id for a shared predicate; pick a free one then.
+    // 0xFFFF is left for decompileRules().
+    auto id_taken = [this](uint16_t id) {
+        for (size_t i = 0; i + 1 < _condition_variables.size(); ++i) {
+            if (_condition_variables[i].id == id) return true;
+        }
+        return false;
+    };
+    uint16_t id = cv.id;
+    if (id_taken(id)) {
+        id = 0xFFFE;
+        while (id_taken(id)) --id;
+        _condition_variables.back().id = id;
+    }
+    return id;
+}
+
+void AuxController::rebuildConditionTable() {
+    _condition_table.clear();
+    for (uint16_t i = 0; i < _condition_variables.size(); ++i) {
+        _condition_table.push_back(std::make_pair(_condition_variables[i].predicateHash(), i));
+    }
+    std::sort(_condition_table.begin(), _condition_table.end());
 }
 
 void AuxController::addMappingRule(const MappingRule& rule) {
     _mapping_rules.push_back(rule);
 }
 
+void AuxController::addMaskTerm(const FunctionMaskTerm& term) {
+    _mask_terms.push_back(term);
+    _mask_term_inputs |= term.inputs();
+}
+
+uint8_t AuxController::addLogicalFunctionForOutput(const uint8_t* effects, uint8_t output_num) {
+    if (!_reuse_slots.empty()) {
+        uint8_t slot = _reuse_slots.back();
+        _reuse_slots.pop_back();
+        return slot;
+    }
+    const uint8_t* effect_cvs = effects + (output_num - 1) * EFFECTS_BLOCK_CV_PER_OUTPUT;
+    LogicalFunction* lf = new LogicalFunction(createEffect(effect_cvs));
+    lf->addOutput(getOutputById(output_num));
+    addLogicalFunction(lf);
+    _lf_outputs.push_back(output_num);
+    _lf_effect_keys.push_back(mappingImageHash(effect_cvs, EFFECTS_BLOCK_CV_PER_OUTPUT));
+    return _logical_functions.size() - 1;
+}
+
 void AuxController::reset() {
-    for (auto lf : _logical_functions) delete lf;
-    _logical_functions.clear();
-    _condition_variables.clear();
-    _mapping_rules.clear();
-    _cv_states.clear();
+    releaseStandby();
+    swapMapping(_standby);
+    releaseStandby();
+    _changed_functions = 0;
+    _direction_changed = false;
+    _evaluate_all = true;
     m_binary_states.clear();
-    for (int i = 0; i < MAX_DCC_FUNCTIONS; ++i) _function_states[i] = false;
+    _function_states = 0;
     _direction = DECODER_DIRECTION_FORWARD;
     _speed = 0;
     _state_changed = true;
 }
 
-void AuxController::evaluateMapping() {
-    _cv_states.clear();
-    for (const auto& cv : _condition_variables) {
-        _cv_states[cv.id] = cv.evaluate(*this);
+void AuxController::swapMapping(MappingBuffer& other) {
+    std::swap(_logical_functions, other.logical_functions);
+    std::swap(_lf_outputs, other.lf_outputs);
+    std::swap(_lf_effect_keys, other.lf_effect_keys);
+    std::swap(_condition_variables, other.condition_variables);
+    std::swap(_mapping_rules, other.mapping_rules);
+    std::swap(_mask_terms, other.mask_terms);
+    std::swap(_mapping_method, other.mapping_method);
+    std::swap(_source_key, other.source_key);
+    std::swap(_mask_term_inputs, other.mask_term_inputs);
+    std::swap(_condition_ids, other.condition_ids);
+    std::swap(_cv_states, other.cv_states);
+    std::swap(_dependencies, other.dependencies);
+    std::swap(_dirty_inputs, other.dirty_inputs);
+    std::swap(_input_queued, other.input_queued);
+    std::swap(_pending_rules, other.pending_rules);
+    std::swap(_rule_queued, other.rule_queued);
+    std::swap(_rule_states, other.rule_states);
+    std::swap(_term_states, other.term_states);
+    std::swap(_lf_levels, other.lf_levels);
+    std::swap(_pending_lfs, other.pending_lfs);
+    std::swap(_lf_queued, other.lf_queued);
+}
+
+void AuxController::beginStandby() {
+    // Park the active mapping in _standby and leave the members empty for the parsers.
+    releaseStandby();
+    swapMapping(_standby);
+    _condition_table.clear();
+}
+
+void AuxController::releaseStandby() {
+    for (auto lf : _standby.logical_functions) delete lf;
+    _standby = MappingBuffer();
+    _standby_ready = false;
+}
+
+void AuxController::activateStandby() {
+    swapMapping(_standby);
+    carryOverLogicalFunctions();
+    // Deleting the old logical functions drops their levels; outputs nothing drives any more go dark.
+    releaseStandby();
+    // The decoder state carried over; evaluate all of it against the new mapping.
+    _changed_functions = 0;
+    _direction_changed = false;
+    _evaluate_all = true;
+    _state_changed = true;
+}
+
+void AuxController::carryOverLogicalFunctions() {
+    // A logical function that drives the same output from the same effect CVs as one of the
+    // mapping being replaced takes over that one's instance, so its effect keeps running
+    // (a soft start stays at full level, a strobe keeps its phase) instead of restarting.
+    // The unused new instance is deleted with the old mapping.
+    std::vector<LogicalFunction*>& old_functions = _standby.logical_functions;
+    std::vector<bool> taken(old_functions.size(), false);
+    for (size_t i = 0; i < _logical_functions.size() && i < _lf_outputs.size(); ++i) {
+        for (size_t j = 0; j < old_functions.size() && j < _standby.lf_outputs.size(); ++j) {
+            if (taken[j] || _standby.lf_outputs[j] != _lf_outputs[i] || _standby.lf_effect_keys[j] != _lf_effect_keys[i]) continue;
+            taken[j] = true;
+            std::swap(_logical_functions[i], old_functions[j]);
+            break;
+        }
+    }
+}
+
+uint16_t AuxController::findConditionIndex(uint16_t cv_id) const {
+    auto it = std::lower_bound(_condition_ids.begin(), _condition_ids.end(), std::make_pair(cv_id, (uint16_t)0));
+    return (it != _condition_ids.end() && it->first == cv_id) ? it->second : (uint16_t)_condition_variables.size();
+}
+
+void AuxController::compileMapping() {
+    // Remap the sparse ConditionVariable ids (see the CV_ID_BASE_* offsets) to dense indices.
+    // Parsers may add the same predicate more than once under one id; the first one is kept.
+    std::vector<std::pair<uint16_t, uint16_t>> by_id;
+    by_id.reserve(_condition_variables.size());
+    for (uint16_t i = 0; i < _condition_variables.size(); ++i) {
+        by_id.push_back(std::make_pair(_condition_variables[i].id, i));
+    }
+    std::stable_sort(by_id.begin(), by_id.end(),
+                     [](const std::pair<uint16_t, uint16_t>& a, const std::pair<uint16_t, uint16_t>& b) { return a.first < b.first; });
+    std::vector<bool> keep(_condition_variables.size(), false);
+    for (size_t i = 0; i < by_id.size(); ++i) {
+        if (i == 0 || by_id[i].first != by_id[i - 1].first) keep[by_id[i].second] = true;
+    }
+    std::vector<ConditionVariable> dense;
+    for (uint16_t i = 0; i < _condition_variables.size(); ++i) {
+        if (keep[i]) dense.push_back(std::move(_condition_variables[i]));
+    }
+    _condition_variables.swap(dense);
+    std::vector<std::pair<uint32_t, uint16_t>>().swap(_condition_table); // Only needed while parsing
+
+    _condition_ids.clear();
+    _condition_ids.reserve(_condition_variables.size());
+    for (uint16_t i = 0; i < _condition_variables.size(); ++i) {
+        _condition_ids.push_back(std::make_pair(_condition_variables[i].id, i));
     }
+    std::sort(_condition_ids.begin(), _condition_ids.end());
+
+    // Unknown ids resolve to the spare bit past the last condition, which always reads false.
+    _cv_states.resize(_condition_variables.size() + 1);
+
+    for (auto& rule : _mapping_rules) {
+        // Rules loaded from a mapping image arrive with their masks already compiled.
+        if (rule.positive_conditions.empty() && rule.negative_conditions.empty()) continue;
+        std::vector<uint16_t> indices;
+        for (uint16_t id : rule.positive_conditions) indices.push_back(findConditionIndex(id));
+        rule.positive_mask = ConditionStateSet::makeMasks(indices);
+        indices.clear();
+        for (uint16_t id : rule.negative_conditions) indices.push_back(findConditionIndex(id));
+        rule.negative_mask = ConditionStateSet::makeMasks(indices);
+        std::vector<uint16_t>().swap(rule.positive_conditions);
+        std::vector<uint16_t>().swap(rule.negative_conditions);
+    }
+
+    _dependencies.build(_condition_variables, _mapping_rules);
+    // Size the work lists once so that evaluation never allocates.
+    _dirty_inputs.clear();
+    _dirty_inputs.reserve(_dependencies.input_keys.size());
+    _input_queued.assign(_dependencies.input_keys.size(), false);
+    _pending_rules.clear();
+    _pending_rules.reserve(_mapping_rules.size());
+    _rule_queued.assign(_mapping_rules.size(), false);
+    _rule_states.assign(_mapping_rules.size(), false);
+    _term_states.assign(_mask_terms.size(), false);
+    _lf_levels.assign(_logical_functions.size(), LogicalFunctionLevel());
     for (const auto& rule : _mapping_rules) {
-        if (rule.evaluate(*this)) {
-            if (rule.target_logical_function_id < _logical_functions.size()) {
-                LogicalFunction* target_func = _logical_functions[rule.target_logical_function_id];
-                bool was_active = target_func->isActive();
-                switch (rule.action) {
-                    case MappingAction::ACTIVATE: target_func->setActive(true); break;
-                    case MappingAction::DEACTIVATE: target_func->setActive(false); break;
-                    case MappingAction::SET_DIMMED: target_func->setDimmed(!target_func->isDimmed()); break;
-                    default: break;
-                }
-                if (target_func->isActive() != was_active) {
-                    _state_changed = true;
+        if (rule.target_logical_function_id >= _lf_levels.size()) continue;
+        if (rule.action == MappingAction::ACTIVATE) _lf_levels[rule.target_logical_function_id].drives_active = true;
+        if (rule.action == MappingAction::SET_DIMMED) _lf_levels[rule.target_logical_function_id].drives_dimmed = true;
+    }
+    for (const auto& term : _mask_terms) {
+        if (term.target_logical_function_id < _lf_levels.size()) _lf_levels[term.target_logical_function_id].drives_active = true;
+    }
+    _pending_lfs.clear();
+    _pending_lfs.reserve(_logical_functions.size());
+    _lf_queued.assign(_logical_functions.size(), false);
+    _evaluate_all = true;
+    _state_changed = true;
+}
+
+void AuxController::noteInputChanged(TriggerSource source, uint8_t parameter) {
+    if (source == TriggerSource::FUNC_KEY && parameter < 32 && ((_mask_term_inputs >> parameter) & 1)) {
+        _changed_functions |= (uint32_t)1 << parameter;
+        _state_changed = true;
+    } else if (source == TriggerSource::DIRECTION && !_mask_terms.empty()) {
+        _direction_changed = true;
+        _state_changed = true;
+    }
+    int slot = _dependencies.findInput(DependencyIndex::makeInputKey(source, parameter));
+    if (slot < 0) return; // Nothing reads this input.
+    if (!_input_queued[slot]) {
+        _input_queued[slot] = true;
+        _dirty_inputs.push_back((uint16_t)slot);
+    }
+    _state_changed = true;
+}
+
+void AuxController::evaluateMapping() {
+    if (_evaluate_all) {
+        _evaluate_all = false;
+        for (uint16_t slot : _dirty_inputs) _input_queued[slot] = false;
+        _dirty_inputs.clear();
+        for (uint16_t i = 0; i < _condition_variables.size(); ++i) {
+            _cv_states.set(i, _condition_variables[i].evaluate(*this));
+        }
+        // Recount every level from scratch. Toggles only record their state: a mapping that
+        // was just loaded has no previous value to see an edge against.
+        for (auto& level : _lf_levels) level.activations = level.blocks = level.dims = 0;
+        for (uint16_t i = 0; i < _mapping_rules.size(); ++i) {
+            const MappingRule& rule = _mapping_rules[i];
+            bool value = rule.evaluate(_cv_states);
+            _rule_states[i] = value;
+            if (!value || rule.target_logical_function_id >= _lf_levels.size()) continue;
+            LogicalFunctionLevel& level = _lf_levels[rule.target_logical_function_id];
+            if (rule.action == MappingAction::ACTIVATE) ++level.activations;
+            else if (rule.action == MappingAction::DEACTIVATE) ++level.blocks;
+            else if (rule.action == MappingAction::SET_DIMMED) ++level.dims;
+        }
+        for (uint16_t i = 0; i < _mask_terms.size(); ++i) {
+            const FunctionMaskTerm& term = _mask_terms[i];
+            bool value = term.evaluate(_function_states, _direction);
+            _term_states[i] = value;
+            if (value && term.target_logical_function_id < _lf_levels.size()) ++_lf_levels[term.target_logical_function_id].activations;
+        }
+        _changed_functions = 0;
+        _direction_changed = false;
+        for (uint8_t i = 0; i < _lf_levels.size(); ++i) queueLogicalFunction(i);
+    }
+
+    if (_direction_changed || _changed_functions) {
+        for (uint16_t i = 0; i < _mask_terms.size(); ++i) {
+            if (_direction_changed || (_mask_terms[i].inputs() & _changed_functions)) updateMaskTerm(i);
+        }
+        _changed_functions = 0;
+        _direction_changed = false;
+    }
+
+    // A logical function changing state can flip conditions on LOGICAL_FUNC_STATE, so settle
+    // those in the same evaluation. Cycles are cut off and continue on the next update.
+    for (int pass = 0; pass < MAX_MAPPING_PASSES; ++pass) {
+        // Re-check only the conditions that read a changed input, then only the rules that
+        // read a condition whose value flipped.
+        for (uint16_t slot : _dirty_inputs) {
+            _input_queued[slot] = false;
+            for (uint16_t i = _dependencies.input_offsets[slot]; i < _dependencies.input_offsets[slot + 1]; ++i) {
+                uint16_t cond = _dependencies.input_conditions[i];
+                bool value = _condition_variables[cond].evaluate(*this);
+                if (value == _cv_states.test(cond)) continue;
+                _cv_states.set(cond, value);
+                for (uint16_t j = _dependencies.condition_offsets[cond]; j < _dependencies.condition_offsets[cond + 1]; ++j) {
+                    uint16_t rule = _dependencies.condition_rules[j];
+                    if (!_rule_queued[rule]) {
+                        _rule_queued[rule] = true;
+                        _pending_rules.push_back(rule);
+                    }
                 }
             }
         }
+        _dirty_inputs.clear();
+
+        for (uint16_t rule : _pending_rules) {
+            _rule_queued[rule] = false;
+            updateRule(rule);
+        }
+        _pending_rules.clear();
+
+        for (uint8_t lf : _pending_lfs) {
+            _lf_queued[lf] = false;
+            applyLogicalFunctionLevel(lf);
+        }
+        _pending_lfs.clear();
+
+        if (_dirty_inputs.empty()) break;
+    }
+    _state_changed = !_dirty_inputs.empty();
+}
+
+void AuxController::queueLogicalFunction(uint8_t index) {
+    if (!_lf_queued[index]) {
+        _lf_queued[index] = true;
+        _pending_lfs.push_back(index);
+    }
+}
+
+void AuxController::updateMaskTerm(uint16_t index) {
+    const FunctionMaskTerm& term = _mask_terms[index];
+    bool value = term.evaluate(_function_states, _direction);
+    if (value == _term_states[index]) return;
+    _term_states[index] = value;
+    if (term.target_logical_function_id >= _logical_functions.size()) return;
+    LogicalFunctionLevel& level = _lf_levels[term.target_logical_function_id];
+    if (value) ++level.activations; else --level.activations;
+    queueLogicalFunction(term.target_logical_function_id);
+}
+
+void AuxController::updateRule(uint16_t index) {
+    const MappingRule& rule = _mapping_rules[index];
+    bool value = rule.evaluate(_cv_states);
+    if (value == _rule_states[index]) return;
+    _rule_states[index] = value;
+    uint8_t target = rule.target_logical_function_id;
+    if (target >= _logical_functions.size()) return;
+    LogicalFunctionLevel& level = _lf_levels[target];
+    LogicalFunction* target_func = _logical_functions[target];
+    switch (rule.action) {
+        case MappingAction::ACTIVATE:
+            if (value) ++level.activations; else --level.activations;
+            queueLogicalFunction(target);
+            break;
+        case MappingAction::DEACTIVATE:
+            if (value) ++level.blocks; else --level.blocks;
+            queueLogicalFunction(target);
+            break;
+        case MappingAction::SET_DIMMED:
+            if (value) ++level.dims; else --level.dims;
+            queueLogicalFunction(target);
+            break;
+        case MappingAction::TOGGLE_ACTIVE:
+            if (!value) break;
+            target_func->setActive(!target_func->isActive());
+            // Conditions on this logical function's state are re-evaluated in the next pass.
+            noteInputChanged(TriggerSource::LOGICAL_FUNC_STATE, target);
+            if (level.blocks > 0) queueLogicalFunction(target);
+            break;
+        case MappingAction::TOGGLE_DIMMED:
+            if (value) target_func->setDimmed(!target_func->isDimmed());
+            break;
+        default:
+            break;
+    }
+}
+
+void AuxController::applyLogicalFunctionLevel(uint8_t index) {
+    LogicalFunction* target_func = _logical_functions[index];
+    const LogicalFunctionLevel& level = _lf_levels[index];
+    bool active = level.drives_active ? level.activations > 0 : target_func->isActive();
+    if (level.blocks > 0) active = false;
+    if (active != target_func->isActive()) {
+        target_func->setActive(active);
+        noteInputChanged(TriggerSource::LOGICAL_FUNC_STATE, index);
+    }
+    if (level.drives_dimmed && (level.dims > 0) != target_func->isDimmed()) {
+        target_func->setDimmed(level.dims > 0);
     }
 }
 
 PhysicalOutput* AuxController::getOutputById(uint8_t id) {
-    return (id < _outputs.size()) ? &_outputs[id] : nullptr;
+    // Output IDs are 1-based as in RCN-225: output 1 is the first registered output.
+    return (id >= 1 && id <= _outputs.size()) ? &_outputs[id - 1] : nullptr;
 }
 
-void AuxController::parseRcn225(ICVAccess& cvAccess) {
+void AuxController::parseRcn225(const uint8_t* mapping, const uint8_t* effects, uint8_t output_num) {
+    // CV33 is F0 forward, CV34 F0 reverse, CV35 onwards F1, F2, ... in both directions.
+    // Every function mapped to the output goes into one term of one logical function.
     const int num_mapping_cvs = CV_OUTPUT_LOCATION_CONFIG_END - CV_OUTPUT_LOCATION_CONFIG_START + 1;
+    FunctionMaskTerm term = {};
     for (int i = 0; i < num_mapping_cvs; ++i) {
-        uint16_t cv_addr = CV_OUTPUT_LOCATION_CONFIG_START + i;
-        uint8_t mapping_mask = cvAccess.readCV(cv_addr);
-        if (mapping_mask == 0) continue;
-
-        ConditionVariable cv;
-        cv.id = i + 1;
+        if (!((mapping[i] >> (output_num - 1)) & 1)) continue;
         if (i == 0) {
-            cv.conditions.push_back({TriggerSource::DIRECTION, TriggerComparator::EQ, DECODER_DIRECTION_FORWARD});
-            cv.conditions.push_back({TriggerSource::FUNC_KEY, TriggerComparator::IS_TRUE, 0});
+            term.function_mask[DECODER_DIRECTION_FORWARD] |= 1;
         } else if (i == 1) {
-            cv.conditions.push_back({TriggerSource::DIRECTION, TriggerComparator::EQ, DECODER_DIRECTION_REVERSE});
-            cv.conditions.push_back({TriggerSource::FUNC_KEY, TriggerComparator::IS_TRUE, 0});
+            term.function_mask[DECODER_DIRECTION_REVERSE] |= 1;
         } else {
-            cv.conditions.push_back({TriggerSource::FUNC_KEY, TriggerComparator::IS_TRUE, (uint8_t)(i - 1)});
-        }
-        addConditionVariable(cv);
-
-        for (int output_bit = 0; output_bit < 8; ++output_bit) {
-            if ((mapping_mask >> output_bit) & 1) {
-                uint8_t physical_output_id = output_bit + 1;
-                LogicalFunction* lf = new LogicalFunction(createEffectFromCVs(cvAccess, physical_output_id));
-                lf->addOutput(getOutputById(physical_output_id));
-                addLogicalFunction(lf);
-                uint8_t lf_idx = _logical_functions.size() - 1;
-                MappingRule rule;
-                rule.target_logical_function_id = lf_idx;
-                rule.positive_conditions.push_back(cv.id);
-                rule.action = MappingAction::ACTIVATE;
-                addMappingRule(rule);
-            }
+            term.function_mask[DECODER_DIRECTION_FORWARD] |= (uint32_t)1 << (i - 1);
+            term.function_mask[DECODER_DIRECTION_REVERSE] |= (uint32_t)1 << (i - 1);
         }
     }
+    if (term.inputs() == 0) return;
+
+    term.target_logical_function_id = addLogicalFunctionForOutput(effects, output_num);
+    addMaskTerm(term);
 }
 
-void AuxController::parseRcn227PerOutputV3(ICVAccess& cvAccess) {
-    cvAccess.writeCV(CV_INDEXED_CV_HIGH_BYTE, 0);
-    cvAccess.writeCV(CV_INDEXED_CV_LOW_BYTE, RCN227_PER_OUTPUT_V3_PAGE);
-    const int num_outputs = 32;
-    for (int output_num = 0; output_num < num_outputs; ++output_num) {
-        LogicalFunction* lf = nullptr;
-        uint16_t base_cv = 257 + (output_num * 8);
-        std::vector<uint16_t> activating_cv_ids, blocking_cv_ids;
-
-        for (int i = 0; i < 4; ++i) {
-            uint8_t cv_value = cvAccess.readCV(base_cv + i);
-            if (cv_value == 255) continue;
-            uint8_t func_num = cv_value & 0x3F;
-            uint8_t dir_bits = (cv_value >> 6) & 0x03;
-            bool is_blocking = (dir_bits == 0x03);
-            ConditionVariable cv;
-            cv.id = CV_ID_BASE_RCN227_PER_OUTPUT_V3 + (output_num * 8) + i;
-            cv.conditions.push_back({TriggerSource::FUNC_KEY, TriggerComparator::IS_TRUE, func_num});
-            if (dir_bits == 0x01) cv.conditions.push_back({TriggerSource::DIRECTION, TriggerComparator::EQ, DECODER_DIRECTION_FORWARD});
-            else if (dir_bits == 0x02) cv.conditions.push_back({TriggerSource::DIRECTION, TriggerComparator::EQ, DECODER_DIRECTION_REVERSE});
-            addConditionVariable(cv);
-            (is_blocking ? blocking_cv_ids : activating_cv_ids).push_back(cv.id);
-        }
+void AuxController::parseRcn227PerOutputV3(const uint8_t* mapping, const uint8_t* effects, uint8_t output_num) {
+    const uint8_t* base_cv = mapping + ((output_num - 1) * 8);
+    uint16_t base_id = CV_ID_BASE_RCN227_PER_OUTPUT_V3 + ((output_num - 1) * 8);
+    std::vector<uint16_t> activating_cv_ids, blocking_cv_ids;
 
-        for (int i = 0; i < 2; ++i) {
-            uint8_t cv_high = cvAccess.readCV(base_cv + 4 + (i * 2));
-            uint8_t cv_low = cvAccess.readCV(base_cv + 5 + (i * 2));
-            if (cv_high == 255 && cv_low == 255) continue;
-            bool is_blocking = (cv_high & 0x80) != 0;
-            uint16_t value = ((cv_high & 0x7F) << 8) | cv_low;
-            ConditionVariable cv;
-            cv.id = CV_ID_BASE_RCN227_PER_OUTPUT_V3 + (output_num * 8) + 4 + i;
-            if (value <= 68) cv.conditions.push_back({TriggerSource::FUNC_KEY, TriggerComparator::IS_TRUE, (uint8_t)value});
-            else cv.conditions.push_back({TriggerSource::BINARY_STATE, TriggerComparator::IS_TRUE, (uint8_t)(value - 69)});
-            addConditionVariable(cv);
-            (is_blocking ? blocking_cv_ids : activating_cv_ids).push_back(cv.id);
-        }
+    for (int i = 0; i < 4; ++i) {
+        uint8_t cv_value = base_cv[i];
+        if (cv_value == 255) continue;
+        uint8_t func_num = cv_value & 0x3F;
+        uint8_t dir_bits = (cv_value >> 6) & 0x03;
+        bool is_blocking = (dir_bits == 0x03);
+        ConditionVariable cv;
+        cv.id = base_id + i;
+        cv.conditions.push_back({TriggerSource::FUNC_KEY, TriggerComparator::IS_TRUE, func_num});
+        if (dir_bits == 0x01) cv.conditions.push_back({TriggerSource::DIRECTION, TriggerComparator::EQ, DECODER_DIRECTION_FORWARD});
+        else if (dir_bits == 0x02) cv.conditions.push_back({TriggerSource::DIRECTION, TriggerComparator::EQ, DECODER_DIRECTION_REVERSE});
+        (is_blocking ? blocking_cv_ids : activating_cv_ids).push_back(addConditionVariable(cv));
+    }
 
-        if (!activating_cv_ids.empty()) {
-            lf = new LogicalFunction(createEffectFromCVs(cvAccess, output_num + 1));
-            lf->addOutput(getOutputById(output_num + 1));
-            addLogicalFunction(lf);
-            uint8_t lf_idx = _logical_functions.size() - 1;
-            for (uint16_t activating_id : activating_cv_ids) {
-                MappingRule rule;
-                rule.target_logical_function_id = lf_idx;
-                rule.positive_conditions.push_back(activating_id);
-                rule.negative_conditions = blocking_cv_ids;
-                rule.action = MappingAction::ACTIVATE;
-                addMappingRule(rule);
-            }
-        }
+    for (int i = 0; i < 2; ++i) {
+        uint8_t cv_high = base_cv[4 + (i * 2)];
+        uint8_t cv_low = base_cv[5 + (i * 2)];
+        if (cv_high == 255 && cv_low == 255) continue;
+        bool is_blocking = (cv_high & 0x80) != 0;
+        uint16_t value = ((cv_high & 0x7F) << 8) | cv_low;
+        ConditionVariable cv;
+        cv.id = base_id + 4 + i;
+        if (value <= 68) cv.conditions.push_back({TriggerSource::FUNC_KEY, TriggerComparator::IS_TRUE, (uint8_t)value});
+        else cv.conditions.push_back({TriggerSource::BINARY_STATE, TriggerComparator::IS_TRUE, (uint8_t)(value - 69)});
+        (is_blocking ? blocking_cv_ids : activating_cv_ids).push_back(addConditionVariable(cv));
     }
-}
 
-void AuxController::parseRcn227PerFunction(ICVAccess& cvAccess) {
-    cvAccess.writeCV(CV_INDEXED_CV_HIGH_BYTE, 0);
-    cvAccess.writeCV(CV_INDEXED_CV_LOW_BYTE, RCN227_PER_FUNCTION_PAGE);
+    if (activating_cv_ids.empty()) return;
+    uint8_t lf_idx = addLogicalFunctionForOutput(effects, output_num);
+    for (uint16_t activating_id : activating_cv_ids) {
+        MappingRule rule;
+        rule.target_logical_function_id = lf_idx;
+        rule.positive_conditions.push_back(activating_id);
+        rule.negative_conditions = blocking_cv_ids;
+        rule.action = MappingAction::ACTIVATE;
+        addMappingRule(rule);
+    }
+}
 
+void AuxController::parseRcn227PerFunction(const uint8_t* mapping, const uint8_t* effects, uint8_t output_num) {
     const int num_functions = 32;
 
+    // One logical function per output; functions sharing a blocking function share a term.
+    std::vector<FunctionMaskTerm> terms;
     for (int func_num = 0; func_num < num_functions; ++func_num) {
         for (int dir = 0; dir < 2; ++dir) {
-            uint16_t base_cv = 257 + (func_num * 2 + dir) * 4;
-            uint32_t output_mask = (uint32_t)cvAccess.readCV(base_cv + 2) << 16 | (uint32_t)cvAccess.readCV(base_cv + 1) << 8 | cvAccess.readCV(base_cv);
-            uint8_t blocking_func_num = cvAccess.readCV(base_cv + 3);
-
-            if (output_mask == 0) continue;
-
-            ConditionVariable cv;
-            cv.id = (func_num * 2) + dir + 1;
-            cv.conditions.push_back({TriggerSource::FUNC_KEY, TriggerComparator::IS_TRUE, (uint8_t)func_num});
-            cv.conditions.push_back({TriggerSource::DIRECTION, TriggerComparator::EQ, (uint8_t)((dir == 0) ? DECODER_DIRECTION_FORWARD : DECODER_DIRECTION_REVERSE)});
-            addConditionVariable(cv);
-
-            uint16_t blocking_cv_id = 0;
-            if (blocking_func_num != 255) {
-                ConditionVariable blocking_cv;
-                blocking_cv.id = CV_ID_BASE_RCN227_PER_FUNCTION_BLOCKING + blocking_func_num;
-                blocking_cv.conditions.push_back({TriggerSource::FUNC_KEY, TriggerComparator::IS_TRUE, blocking_func_num});
-                addConditionVariable(blocking_cv);
-                blocking_cv_id = blocking_cv.id;
-            }
+            const uint8_t* base_cv = mapping + (func_num * 2 + dir) * 4;
+            uint32_t output_mask = (uint32_t)base_cv[2] << 16 | (uint32_t)base_cv[1] << 8 | base_cv[0];
+            if (!((output_mask >> (output_num - 1)) & 1)) continue;
+            uint8_t blocking_func_num = base_cv[3];
+            uint32_t blocking_mask = (blocking_func_num < 32) ? (uint32_t)1 << blocking_func_num : 0;
 
-            for (int output_bit = 0; output_bit < 24; ++output_bit) {
-                if ((output_mask >> output_bit) & 1) {
-                    uint8_t physical_output_id = output_bit + 1;
-                    LogicalFunction* lf = new LogicalFunction(createEffectFromCVs(cvAccess, physical_output_id));
-                    lf->addOutput(getOutputById(physical_output_id));
-                    addLogicalFunction(lf);
-                    uint8_t lf_idx = _logical_functions.size() - 1;
-
-                    MappingRule rule;
-                    rule.target_logical_function_id = lf_idx;
-                    rule.positive_conditions.push_back(cv.id);
-                    if (blocking_cv_id != 0) rule.negative_conditions.push_back(blocking_cv_id);
-                    rule.action = MappingAction::ACTIVATE;
-                    addMappingRule(rule);
-                }
+            auto term = std::find_if(terms.begin(), terms.end(),
+                                     [&](const FunctionMaskTerm& t) { return t.blocking_mask == blocking_mask; });
+            if (term == terms.end()) {
+                FunctionMaskTerm new_term = {};
+                new_term.blocking_mask = blocking_mask;
+                terms.push_back(new_term);
+                term = terms.end() - 1;
             }
+            term->function_mask[(dir == 0) ? DECODER_DIRECTION_FORWARD : DECODER_DIRECTION_REVERSE] |= (uint32_t)1 << func_num;
         }
     }
-}
-
-void AuxController::parseRcn227PerOutputV1(ICVAccess& cvAccess) {
-    cvAccess.writeCV(CV_INDEXED_CV_HIGH_BYTE, 0);
-    cvAccess.writeCV(CV_INDEXED_CV_LOW_BYTE, RCN227_PER_OUTPUT_V1_PAGE);
-
-    const int num_outputs = 24;
-
-    for (int output_num = 0; output_num < num_outputs; ++output_num) {
-        LogicalFunction* lf = nullptr; // Lazily created
+    if (terms.empty()) return;
 
-        for (int dir = 0; dir < 2; ++dir) {
-            uint16_t base_cv = 257 + (output_num * 2 + dir) * 4;
-            uint32_t func_mask = (uint32_t)cvAccess.readCV(base_cv + 3) << 24 | (uint32_t)cvAccess.readCV(base_cv + 2) << 16 | (uint32_t)cvAccess.readCV(base_cv + 1) << 8 | cvAccess.readCV(base_cv);
-
-            if (func_mask == 0) continue;
+    uint8_t lf_idx = addLogicalFunctionForOutput(effects, output_num);
+    for (auto& term : terms) {
+        term.target_logical_function_id = lf_idx;
+        addMaskTerm(term);
+    }
+}
 
-            if (lf == nullptr) {
-                lf = new LogicalFunction(createEffectFromCVs(cvAccess, output_num + 1));
-                lf->addOutput(getOutputById(output_num + 1));
-                addLogicalFunction(lf);
-            }
-            uint8_t lf_idx = _logical_functions.size() - 1;
-
-            for (int func_num = 0; func_num < 32; ++func_num) {
-                if ((func_mask >> func_num) & 1) {
-                    ConditionVariable cv;
-                    cv.id = CV_ID_BASE_RCN227_PER_OUTPUT_V1 + (output_num * 64) + (dir * 32) + func_num; // Unique ID
-                    cv.conditions.push_back({TriggerSource::FUNC_KEY, TriggerComparator::IS_TRUE, (uint8_t)func_num});
-                    cv.conditions.push_back({TriggerSource::DIRECTION, TriggerComparator::EQ, (uint8_t)((dir == 0) ? DECODER_DIRECTION_FORWARD : DECODER_DIRECTION_REVERSE)});
-                    addConditionVariable(cv);
-
-                    MappingRule rule;
-                    rule.target_logical_function_id = lf_idx;
-                    rule.positive_conditions.push_back(cv.id);
-                    rule.action = MappingAction::ACTIVATE;
-                    addMappingRule(rule);
-                }
-            }
-        }
+void AuxController::parseRcn227PerOutputV1(const uint8_t* mapping, const uint8_t* effects, uint8_t output_num) {
+    FunctionMaskTerm term = {};
+    for (int dir = 0; dir < 2; ++dir) {
+        const uint8_t* base_cv = mapping + ((output_num - 1) * 2 + dir) * 4;
+        uint32_t func_mask = (uint32_t)base_cv[3] << 24 | (uint32_t)base_cv[2] << 16 | (uint32_t)base_cv[1] << 8 | base_cv[0];
+        term.function_mask[(dir == 0) ? DECODER_DIRECTION_FORWARD : DECODER_DIRECTION_REVERSE] = func_mask;
     }
+    if (term.inputs() == 0) return;
+
+    term.target_logical_function_id = addLogicalFunctionForOutput(effects, output_num);
+    addMaskTerm(term);
 }
 
 Effect* AuxController::createEffectFromCVs(ICVAccess& cvAccess, uint8_t output_num) {
-    cvAccess.writeCV(CV_INDEXED_CV_HIGH_BYTE, 0);
-    cvAccess.writeCV(CV_INDEXED_CV_LOW_BYTE, EFFECTS_BLOCK_PAGE);
-
-    uint16_t base_cv = 257 + ((output_num - 1) * EFFECTS_BLOCK_CV_PER_OUTPUT);
-    uint8_t effect_type = cvAccess.readCV(base_cv + EFFECTS_CV_OFFSET_TYPE);
+    uint8_t effect_cvs[EFFECTS_BLOCK_CV_PER_OUTPUT];
+    uint16_t base_cv = CV_INDEXED_WINDOW_START + ((output_num - 1) * EFFECTS_BLOCK_CV_PER_OUTPUT);
+    cvAccess.readCVs(EFFECTS_BLOCK_PAGE, base_cv, EFFECTS_BLOCK_CV_PER_OUTPUT, effect_cvs);
+    return createEffect(effect_cvs);
+}
 
-    uint16_t p1 = (uint16_t)cvAccess.readCV(base_cv + EFFECTS_CV_OFFSET_PARAM1_MSB) << 8 | cvAccess.readCV(base_cv + EFFECTS_CV_OFFSET_PARAM1_LSB);
-    uint16_t p2 = (uint16_t)cvAccess.readCV(base_cv + EFFECTS_CV_OFFSET_PARAM2_MSB) << 8 | cvAccess.readCV(base_cv + EFFECTS_CV_OFFSET_PARAM2_LSB);
-    uint16_t p3 = (uint16_t)cvAccess.readCV(base_cv + EFFECTS_CV_OFFSET_PARAM3_MSB) << 8 | cvAccess.readCV(base_cv + EFFECTS_CV_OFFSET_PARAM3_LSB);
+Effect* AuxController::createEffect(const uint8_t* effect_cvs) {
+    uint8_t effect_type = effect_cvs[EFFECTS_CV_OFFSET_TYPE];
+    uint16_t p1 = (uint16_t)effect_cvs[EFFECTS_CV_OFFSET_PARAM1_MSB] << 8 | effect_cvs[EFFECTS_CV_OFFSET_PARAM1_LSB];
+    uint16_t p2 = (uint16_t)effect_cvs[EFFECTS_CV_OFFSET_PARAM2_MSB] << 8 | effect_cvs[EFFECTS_CV_OFFSET_PARAM2_LSB];
+    uint16_t p3 = (uint16_t)effect_cvs[EFFECTS_CV_OFFSET_PARAM3_MSB] << 8 | effect_cvs[EFFECTS_CV_OFFSET_PARAM3_LSB];
 
     switch (effect_type) {
         case EFFECT_TYPE_DIMMING:
@@ -397,63 +1136,48 @@ Effect* AuxController::createEffectFromCVs(ICVAccess& cvAccess, uint8_t output_n
     }
 }
 
-void AuxController::parseRcn227PerOutputV2(ICVAccess& cvAccess) {
-    cvAccess.writeCV(CV_INDEXED_CV_HIGH_BYTE, 0);
-    cvAccess.writeCV(CV_INDEXED_CV_LOW_BYTE, RCN227_PER_OUTPUT_V2_PAGE);
+void AuxController::parseRcn227PerOutputV2(const uint8_t* mapping, const uint8_t* effects, uint8_t output_num) {
+    bool has_lf = false;
+    uint8_t lf_idx = 0;
 
-    const int num_outputs = 32;
+    for (int dir = 0; dir < 2; ++dir) {
+        const uint8_t* base_cv = mapping + ((output_num - 1) * 2 + dir) * 4;
+        const uint8_t* funcs = base_cv;
+        uint8_t blocking_func = base_cv[3];
 
-    for (int output_num = 0; output_num < num_outputs; ++output_num) {
-        LogicalFunction* lf = nullptr;
+        uint16_t blocking_cv_id = 0;
+        if (blocking_func != 255) {
+            ConditionVariable blocking_cv;
+            blocking_cv.id = CV_ID_BASE_RCN227_PER_OUTPUT_V2_BLOCKING + blocking_func; // Unique ID
+            if (blocking_func > 28) {
+                blocking_cv.conditions.push_back({TriggerSource::BINARY_STATE, TriggerComparator::IS_TRUE, (uint16_t)(blocking_func)});
+            } else {
+                blocking_cv.conditions.push_back({TriggerSource::FUNC_KEY, TriggerComparator::IS_TRUE, blocking_func});
+            }
+            blocking_cv_id = addConditionVariable(blocking_cv);
+        }
 
-        for (int dir = 0; dir < 2; ++dir) {
-            uint16_t base_cv = 257 + (output_num * 2 + dir) * 4;
-            uint8_t funcs[] = {
-                cvAccess.readCV(base_cv),
-                cvAccess.readCV(base_cv + 1),
-                cvAccess.readCV(base_cv + 2)
-            };
-            uint8_t blocking_func = cvAccess.readCV(base_cv + 3);
-
-            uint16_t blocking_cv_id = 0;
-            if (blocking_func != 255) {
-                ConditionVariable blocking_cv;
-                blocking_cv.id = CV_ID_BASE_RCN227_PER_OUTPUT_V2_BLOCKING + blocking_func; // Unique ID
-                if (blocking_func > 28) {
-                    blocking_cv.conditions.push_back({TriggerSource::BINARY_STATE, TriggerComparator::IS_TRUE, (uint16_t)(blocking_func)});
-                } else {
-                    blocking_cv.conditions.push_back({TriggerSource::FUNC_KEY, TriggerComparator::IS_TRUE, blocking_func});
+        for (int i = 0; i < 3; ++i) {
+            if (funcs[i] != 255) {
+                if (!has_lf) {
+                    lf_idx = addLogicalFunctionForOutput(effects, output_num);
+                    has_lf = true;
                 }
-                addConditionVariable(blocking_cv);
-                blocking_cv_id = blocking_cv.id;
-            }
 
-            for (int i = 0; i < 3; ++i) {
-                if (funcs[i] != 255) {
-                    if (lf == nullptr) {
-                        lf = new LogicalFunction(createEffectFromCVs(cvAccess, output_num + 1));
-                        lf->addOutput(getOutputById(output_num + 1));
-                        addLogicalFunction(lf);
-                    }
-                    uint8_t lf_idx = _logical_functions.size() - 1;
-
-                    ConditionVariable cv;
-                    cv.id = CV_ID_BASE_RCN227_PER_OUTPUT_V2 + (output_num * 8) + (dir * 4) + i; // Unique ID
-                    if (funcs[i] > 28) {
-                        cv.conditions.push_back({TriggerSource::BINARY_STATE, TriggerComparator::IS_TRUE, (uint16_t)(funcs[i])});
-                    } else {
-                        cv.conditions.push_back({TriggerSource::FUNC_KEY, TriggerComparator::IS_TRUE, funcs[i]});
-                    }
-                    cv.conditions.push_back({TriggerSource::DIRECTION, TriggerComparator::EQ, (uint8_t)((dir == 0) ? DECODER_DIRECTION_FORWARD : DECODER_DIRECTION_REVERSE)});
-                    addConditionVariable(cv);
-
-                    MappingRule rule;
-                    rule.target_logical_function_id = lf_idx;
-                    rule.positive_conditions.push_back(cv.id);
-                    if (blocking_cv_id != 0) rule.negative_conditions.push_back(blocking_cv_id);
-                    rule.action = MappingAction::ACTIVATE;
-                    addMappingRule(rule);
+                ConditionVariable cv;
+                cv.id = CV_ID_BASE_RCN227_PER_OUTPUT_V2 + ((output_num - 1) * 8) + (dir * 4) + i; // Unique ID
+                if (funcs[i] > 28) {
+                    cv.conditions.push_back({TriggerSource::BINARY_STATE, TriggerComparator::IS_TRUE, (uint16_t)(funcs[i])});
+                } else {
+                    cv.conditions.push_back({TriggerSource::FUNC_KEY, TriggerComparator::IS_TRUE, funcs[i]});
                 }
+                cv.conditions.push_back({TriggerSource::DIRECTION, TriggerComparator::EQ, (uint8_t)((dir == 0) ? DECODER_DIRECTION_FORWARD : DECODER_DIRECTION_REVERSE)});
+                MappingRule rule;
+                rule.target_logical_function_id = lf_idx;
+                rule.positive_conditions.push_back(addConditionVariable(cv));
+                if (blocking_cv_id != 0) rule.negative_conditions.push_back(blocking_cv_id);
+                rule.action = MappingAction::ACTIVATE;
+                addMappingRule(rule);
             }
         }
     }
@@ -13,12 +13,16 @@
 #include <cstdint>
 #include <memory>
 #include "interfaces/ICVAccess.h"
+#include "interfaces/IMappingImageSource.h"
 #include "LightSources/LightSource.h"
 #include "PhysicalOutput.h"
 #include "LogicalFunction.h"
 #include "FunctionMapping.h"
+#include "MappingImage.h"
 
 #define MAX_DCC_FUNCTIONS 29
+// Evaluation passes per update for conditions on logical function states to settle.
+#define MAX_MAPPING_PASSES 4
 
 namespace xDuinoRails {
 
@@ -47,27 +51,99 @@ public:
 
     /**
      * @brief Adds and initializes a physical output.
+     *
+     * Outputs are numbered from 1 in the order they are added, across addPhysicalOutput()
+     * and addLightSource(): the first one is output 1, which mapping bit 0 drives.
      * @param pin The microcontroller pin number.
      * @param type The type of the output (LIGHT_SOURCE or SERVO).
      */
     void addPhysicalOutput(uint8_t pin, OutputType type);
 
     /**
-     * @brief Adds and initializes a light source physical output.
+     * @brief Adds and initializes a light source physical output; numbered like addPhysicalOutput().
      * @param lightSource A unique_ptr to a LightSource object.
      */
     void addLightSource(std::unique_ptr<LightSource> lightSource);
 
+    /**
+     * @brief Sets how an output combines the levels of several logical functions driving it.
+     * @param id The 1-based output number.
+     * @param mode The combine rule; outputs start with CombineMode::MAX.
+     */
+    void setCombineMode(uint8_t id, CombineMode mode);
+
+    /**
+     * @brief Sets the curve an output applies to its combined level before writing it.
+     * @param id The 1-based output number.
+     * @param curve The curve; outputs start with their light source's brightnessCurve().
+     */
+    void setBrightnessCurve(uint8_t id, BrightnessCurve curve);
+
     /**
      * @brief Updates the state of all logical functions and effects. Call every loop.
+     *
+     * Effects write their levels into the outputs first; a final pass then combines the levels
+     * of each output (see setCombineMode()) and commits it, so every light source is written
+     * and a NeoPixel strip is transmitted at most once per update.
+     *
+     * Effects and light sources that have nothing to do are skipped. The return value tells
+     * the caller how long it may sleep: update() is next needed after that many milliseconds,
+     * or after the next state change (setFunctionState() etc.) if it is UPDATE_IDLE.
      * @param delta_ms Time elapsed since the last update in milliseconds.
+     * @return Milliseconds until the earliest deadline, UPDATE_NEXT_TICK or UPDATE_IDLE.
      */
-    void update(uint32_t delta_ms);
+    uint32_t update(uint32_t delta_ms);
     /**
      * @brief Loads the entire function mapping configuration from CVs.
+     *
+     * The new mapping is built next to the active one, which keeps running until the next
+     * update() swaps them. Function states, direction, speed and binary states carry over,
+     * so outputs that stay on are not switched off in between. A logical function that drives
+     * the same output with the same effect CVs as before keeps its running effect.
      * @param cvAccess A reference to an object that implements the ICVAccess interface.
      */
     void loadFromCVs(ICVAccess& cvAccess);
+    /**
+     * @brief Applies a single CV write without reloading the whole mapping.
+     *
+     * Only the outputs the CV belongs to are rebuilt: an effects CV replaces that output's
+     * effect, a mapping CV re-parses the conditions, rules and logical functions driving the
+     * outputs it maps. Every other effect keeps running, and function states, direction and
+     * speed are kept. Writing CV96 (the mapping method) reloads all outputs.
+     * @param cvAccess The CVs the mapping was loaded from, already holding the new value.
+     * @param page The page selected by CV31/CV32 for CVs 257-512; ignored for other CVs.
+     * @param cv_number The CV that was written.
+     */
+    void reloadCV(ICVAccess& cvAccess, uint16_t page, uint16_t cv_number);
+    /**
+     * @brief Serializes the loaded mapping into a compact, versioned image.
+     *
+     * Store the image (e.g. in EEPROM or flash) and pass it to loadFromImage() on the next
+     * boot to skip parsing. The image is keyed to the CVs the mapping was loaded from.
+     * A mapping still waiting for update() is activated first.
+     * @param cvAccess The CVs the mapping was loaded from; their effect CVs go into the image.
+     * @param image Receives the image; previous contents are replaced.
+     * @return False, leaving @p image empty, if the CVs changed since the mapping was loaded.
+     */
+    bool saveMappingImage(ICVAccess& cvAccess, std::vector<uint8_t>& image);
+    /**
+     * @brief Loads a mapping from an image written by saveMappingImage().
+     *
+     * Nothing is parsed. If ICVAccess::changeCounter() still has the value it had when the
+     * image was saved, only CV96 is read; otherwise the mapping and effects pages are read and
+     * hashed to check the image. Fails if the image is corrupt, from another version or stale;
+     * call loadFromCVs() (and save a new image) in that case. Like loadFromCVs(), the mapping
+     * takes over on the next update(); a rejected image leaves the active one running.
+     * @return True if the image was loaded.
+     */
+    bool loadFromImage(ICVAccess& cvAccess, const std::vector<uint8_t>& image);
+    /**
+     * @brief Loads a mapping image straight from storage, without copying it into RAM.
+     *
+     * Same as the overload above; implement IMappingImageSource for the EEPROM or flash area
+     * the image was stored in.
+     */
+    bool loadFromImage(ICVAccess& cvAccess, IMappingImageSource& image);
 
     // --- State Update Methods ---
     /**
@@ -107,7 +183,7 @@ public:
     /**
      * @brief Gets the evaluated state of a ConditionVariable.
      * @param cv_id The ID of the ConditionVariable.
-     * @return The cached boolean result of the variable's evaluation.
+     * @return The cached boolean result of the variable's evaluation, or false for unknown ids.
      */
     bool getConditionVariableState(uint16_t cv_id) const;
     /**
@@ -130,37 +206,147 @@ public:
      */
     const LogicalFunction* getLogicalFunction(size_t index) const;
 
+    /**
+     * @brief Gets the number of output writes skipped because the value did not change.
+     * @return The sum of PhysicalOutput::getElidedWriteCount() over all outputs.
+     */
+    uint32_t getElidedWriteCount() const;
+    /**
+     * @brief Makes the next update() re-evaluate every condition and rule, as after a reload.
+     *
+     * Normally only the conditions whose inputs changed are evaluated again.
+     */
+    void forceFullEvaluation();
+
+    /**
+     * @brief Gets the effect time: the sum of all update() deltas.
+     *
+     * Effects animate on this clock rather than millis(), so a host simulation can step
+     * hours of layout time without waiting for them.
+     */
+    uint32_t nowMs() const { return _clock.nowMs(); }
+    /**
+     * @brief Re-seeds the random streams of all effects (flicker, fire).
+     * @param seed Controllers with the same seed and configuration render identical output.
+     */
+    void setRandomSeed(uint32_t seed);
+
 #ifdef UNIT_TEST
 public:
-#endif
+#else
 private:
+#endif
     void addLogicalFunction(LogicalFunction* function);
-    void addConditionVariable(const ConditionVariable& cv);
+    uint16_t addConditionVariable(const ConditionVariable& cv);
+    void rebuildConditionTable();
     void addMappingRule(const MappingRule& rule);
+    void addMaskTerm(const FunctionMaskTerm& term);
+    /// A complete compiled mapping. loadFromCVs() builds the next one while the active one,
+    /// held in the AuxController members, keeps rendering.
+    struct MappingBuffer {
+        std::vector<LogicalFunction*> logical_functions;
+        std::vector<uint8_t> lf_outputs;
+        std::vector<uint32_t> lf_effect_keys;
+        std::vector<ConditionVariable> condition_variables;
+        std::vector<MappingRule> mapping_rules;
+        std::vector<FunctionMaskTerm> mask_terms;
+        FunctionMappingMethod mapping_method = FunctionMappingMethod::PROPRIETARY;
+        uint32_t source_key = 0;
+        uint32_t mask_term_inputs = 0;
+        std::vector<std::pair<uint16_t, uint16_t>> condition_ids;
+        ConditionStateSet cv_states;
+        DependencyIndex dependencies;
+        std::vector<uint16_t> dirty_inputs;
+        std::vector<bool> input_queued;
+        std::vector<uint16_t> pending_rules;
+        std::vector<bool> rule_queued;
+        std::vector<bool> rule_states;
+        std::vector<bool> term_states;
+        std::vector<LogicalFunctionLevel> lf_levels;
+        std::vector<uint8_t> pending_lfs;
+        std::vector<bool> lf_queued;
+    };
+
     void reset();
+    void swapMapping(MappingBuffer& other);
+    void beginStandby();
+    void releaseStandby();
+    void activateStandby();
+    void carryOverLogicalFunctions();
+    void compileMapping();
+    uint16_t findConditionIndex(uint16_t cv_id) const;
+    void noteInputChanged(TriggerSource source, uint8_t parameter);
+    void updateRule(uint16_t index);
+    void updateMaskTerm(uint16_t index);
+    void queueLogicalFunction(uint8_t index);
+    void applyLogicalFunctionLevel(uint8_t index);
+    uint8_t addLogicalFunctionForOutput(const uint8_t* effects, uint8_t output_num);
+    void removeLogicalFunction(uint8_t index);
+    void decompileRules();
+    uint32_t outputsAffectedBy(const uint8_t* mapping, uint16_t page, uint16_t cv_number) const;
+    uint32_t outputsWithMaskTerm(uint32_t forward_mask, uint32_t reverse_mask) const;
+    void rebuildOutput(const uint8_t* mapping, const uint8_t* effects, uint8_t output_num);
+    uint32_t readMappingSource(ICVAccess& cvAccess, FunctionMappingMethod& method, uint8_t* mapping, uint8_t* effects);
 
     void evaluateMapping();
+    /// @return The output with the 1-based number @p id, or nullptr (also for id 0).
     PhysicalOutput* getOutputById(uint8_t id);
 
     // --- CV Loading ---
+    // The parsers read the mapping CVs and the effects block (CVs 257-512 of
+    // EFFECTS_BLOCK_PAGE) from buffers that loadFromCVs() fetches once. Each call
+    // builds everything that drives one output (1-based), so outputs can be rebuilt
+    // one at a time.
     Effect* createEffectFromCVs(ICVAccess& cvAccess, uint8_t output_num);
-    void parseRcn225(ICVAccess& cvAccess);
-    void parseRcn227PerFunction(ICVAccess& cvAccess);
-    void parseRcn227PerOutputV1(ICVAccess& cvAccess);
-    void parseRcn227PerOutputV2(ICVAccess& cvAccess);
-    void parseRcn227PerOutputV3(ICVAccess& cvAccess);
+    Effect* createEffect(const uint8_t* effect_cvs);
+    static uint8_t mappingOutputCount(FunctionMappingMethod method);
+    void parseOutput(const uint8_t* mapping, const uint8_t* effects, uint8_t output_num);
+    void parseRcn225(const uint8_t* mapping, const uint8_t* effects, uint8_t output_num);
+    void parseRcn227PerFunction(const uint8_t* mapping, const uint8_t* effects, uint8_t output_num);
+    void parseRcn227PerOutputV1(const uint8_t* mapping, const uint8_t* effects, uint8_t output_num);
+    void parseRcn227PerOutputV2(const uint8_t* mapping, const uint8_t* effects, uint8_t output_num);
+    void parseRcn227PerOutputV3(const uint8_t* mapping, const uint8_t* effects, uint8_t output_num);
 
     std::vector<PhysicalOutput> _outputs;
+    EffectClock _clock; ///< Time base and seed of every effect; advanced by update().
     std::vector<LogicalFunction*> _logical_functions;
+    std::vector<uint8_t> _lf_outputs; ///< Output number each logical function drives and takes its effect from.
+    std::vector<uint32_t> _lf_effect_keys; ///< Hash of the effect CVs each logical function was built from.
     std::vector<ConditionVariable> _condition_variables;
     std::vector<MappingRule> _mapping_rules;
+    std::vector<FunctionMaskTerm> _mask_terms;
+    FunctionMappingMethod _mapping_method = FunctionMappingMethod::PROPRIETARY;
+    uint32_t _source_key = 0; ///< Hash of the CVs the mapping was loaded from.
+    /// (predicateHash, index) of every entry of _condition_variables, sorted; only valid while parsing.
+    std::vector<std::pair<uint32_t, uint16_t>> _condition_table;
+    MappingBuffer _standby;       ///< The mapping update() swaps in next.
+    bool _standby_ready = false;  ///< _standby holds a loaded mapping.
+    /// Logical function slots of the output being rebuilt, reused in order by addLogicalFunctionForOutput().
+    std::vector<uint8_t> _reuse_slots;
 
     // --- Decoder State ---
-    bool _function_states[MAX_DCC_FUNCTIONS] = {false};
+    uint32_t _function_states = 0; ///< Bit n is the state of Fn.
     DecoderDirection _direction = DECODER_DIRECTION_FORWARD;
     uint16_t _speed = 0;
     std::map<uint16_t, bool> m_binary_states;
-    std::map<uint16_t, bool> _cv_states;
+    /// (ConditionVariable id, dense index) pairs sorted by id, built by compileMapping().
+    std::vector<std::pair<uint16_t, uint16_t>> _condition_ids;
+    /// Evaluated ConditionVariable states by dense index, plus one spare bit that is never set.
+    ConditionStateSet _cv_states;
+    DependencyIndex _dependencies;
+    std::vector<uint16_t> _dirty_inputs;  ///< Input slots changed since the last evaluation.
+    std::vector<bool> _input_queued;      ///< Per input slot: already in _dirty_inputs.
+    std::vector<uint16_t> _pending_rules; ///< Rules whose conditions changed in this evaluation.
+    std::vector<bool> _rule_queued;       ///< Per rule: already in _pending_rules.
+    std::vector<bool> _rule_states;       ///< Per rule: value at the last evaluation.
+    std::vector<bool> _term_states;       ///< Per mask term: value at the last evaluation.
+    std::vector<LogicalFunctionLevel> _lf_levels; ///< Per logical function: true level rules and terms.
+    std::vector<uint8_t> _pending_lfs;    ///< Logical functions whose level rules or terms changed.
+    std::vector<bool> _lf_queued;         ///< Per logical function: already in _pending_lfs.
+    uint32_t _mask_term_inputs = 0;       ///< Functions read by any FunctionMaskTerm.
+    uint32_t _changed_functions = 0;      ///< Functions read by mask terms that changed since the last evaluation.
+    bool _direction_changed = false;      ///< Direction changed since the last evaluation.
+    bool _evaluate_all = true;            ///< Next evaluation re-checks every condition and rule.
     bool _state_changed = true;
 };
 
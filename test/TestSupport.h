@@ -0,0 +1,47 @@
+/**
+ * @file TestSupport.h
+ * @brief Minimal assertion helpers for the host test executables.
+ */
+#ifndef XDRAILS_TEST_SUPPORT_H
+#define XDRAILS_TEST_SUPPORT_H
+
+#include <cstdio>
+
+namespace TestSupport {
+inline int& failures() {
+    static int count = 0;
+    return count;
+}
+}
+
+#define CHECK(cond)                                                                 \
+    do {                                                                            \
+        if (!(cond)) {                                                              \
+            std::printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #cond);    \
+            ++TestSupport::failures();                                              \
+        }                                                                           \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                              \
+    do {                                                                            \
+        long long _va = (long long)(a);                                             \
+        long long _vb = (long long)(b);                                             \
+        if (_va != _vb) {                                                           \
+            std::printf("%s:%d: CHECK_EQ failed: %s == %s (%lld != %lld)\n",        \
+                        __FILE__, __LINE__, #a, #b, _va, _vb);                      \
+            ++TestSupport::failures();                                              \
+        }                                                                           \
+    } while (0)
+
+#define RUN_TEST(fn)                                                                \
+    do {                                                                            \
+        VirtualHardware::reset();                                                   \
+        std::printf("[ RUN  ] %s\n", #fn);                                          \
+        fn();                                                                       \
+    } while (0)
+
+#define TEST_MAIN_RESULT()                                                          \
+    (TestSupport::failures() == 0 ? (std::printf("[ PASS ]\n"), 0)                  \
+                                  : (std::printf("[ FAIL ] %d check(s)\n", TestSupport::failures()), 1))
+
+#endif // XDRAILS_TEST_SUPPORT_H
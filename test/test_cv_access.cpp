@@ -0,0 +1,100 @@
+#include <Arduino.h>
+#include <MemoryCVAccess.h>
+#include "ShadowCVAccess.h"
+#include "cv_definitions.h"
+#include "TestSupport.h"
+
+using namespace xDuinoRails;
+
+static void testReadsAreServedFromRam() {
+    MemoryCVAccess backing;
+    backing.writeCV(CV_MANUFACTURER_ID, 13);
+    backing.writeIndexedCV(EFFECTS_BLOCK_PAGE, 260, 42);
+    backing.resetCounters();
+
+    ShadowCVAccess shadow(backing);
+    CHECK_EQ(shadow.readCV(CV_MANUFACTURER_ID), 13);
+    CHECK_EQ(shadow.readCV(CV_MANUFACTURER_ID), 13);
+    shadow.writeCV(CV_INDEXED_CV_LOW_BYTE, EFFECTS_BLOCK_PAGE);
+    CHECK_EQ(shadow.readCV(260), 42);
+    uint32_t reads = backing.readCount() + backing.blockReadCount();
+    CHECK_EQ(shadow.readCV(260), 42);
+    CHECK_EQ(shadow.readCV(CV_MANUFACTURER_ID), 13);
+    CHECK_EQ(backing.readCount() + backing.blockReadCount(), reads);
+    // Selecting the page only touched the shadow.
+    CHECK_EQ(backing.writeCount(), 0);
+    CHECK_EQ(backing.readIndexedCV(0, CV_INDEXED_CV_LOW_BYTE), 0);
+}
+
+static void testWritesAreCoalescedUntilFlush() {
+    MemoryCVAccess backing;
+    backing.writeCV(CV_ACCELERATION_RATE, 10);
+    backing.resetCounters();
+
+    ShadowCVAccess shadow(backing);
+    for (int i = 0; i < 20; ++i) shadow.writeCV(CV_DECELERATION_RATE, (uint8_t)i);
+    shadow.writeCV(CV_ACCELERATION_RATE, 11);
+    shadow.writeCV(CV_ACCELERATION_RATE, 10); // Back to the stored value, but still marked dirty
+    // Alternate between two pages, as a programming session would.
+    for (int i = 0; i < 10; ++i) {
+        shadow.writeCV(CV_INDEXED_CV_LOW_BYTE, RCN227_PER_OUTPUT_V3_PAGE);
+        shadow.writeCV(257 + i, (uint8_t)(i + 1));
+        shadow.writeCV(CV_INDEXED_CV_LOW_BYTE, EFFECTS_BLOCK_PAGE);
+        shadow.writeCV(257 + i, (uint8_t)(100 + i));
+    }
+    CHECK_EQ(backing.writeCount(), 0);
+    CHECK_EQ(shadow.dirtyCount(), 2 + 20 + 1);
+
+    shadow.flush();
+    CHECK_EQ(shadow.dirtyCount(), 0);
+    // Two CVs, 20 indexed CVs and one page switch per page; the final page is left selected.
+    CHECK_EQ(backing.writeCount(), 2 + 20 + 2);
+    CHECK_EQ(backing.readIndexedCV(0, CV_DECELERATION_RATE), 19);
+    CHECK_EQ(backing.readIndexedCV(RCN227_PER_OUTPUT_V3_PAGE, 266), 10);
+    CHECK_EQ(backing.readIndexedCV(EFFECTS_BLOCK_PAGE, 266), 109);
+    CHECK_EQ(backing.readCV(CV_INDEXED_CV_LOW_BYTE), EFFECTS_BLOCK_PAGE);
+
+    backing.resetCounters();
+    shadow.writeCV(CV_DECELERATION_RATE, 19); // Unchanged
+    CHECK_EQ(shadow.dirtyCount(), 0);
+    shadow.flush();
+    CHECK_EQ(backing.writeCount(), 0);
+}
+
+static void testBlockReadPrefersCachedValues() {
+    MemoryCVAccess backing;
+    for (int cv = 257; cv < 265; ++cv) backing.writeIndexedCV(EFFECTS_BLOCK_PAGE, cv, 1);
+    ShadowCVAccess shadow(backing);
+    shadow.writeCV(CV_INDEXED_CV_LOW_BYTE, EFFECTS_BLOCK_PAGE);
+    shadow.writeCV(259, 7);
+
+    uint8_t buffer[8];
+    backing.resetCounters();
+    shadow.readCVs(EFFECTS_BLOCK_PAGE, 257, 8, buffer);
+    CHECK_EQ(buffer[0], 1);
+    CHECK_EQ(buffer[2], 7);
+    CHECK_EQ(backing.blockReadCount(), 1);
+    shadow.readCVs(EFFECTS_BLOCK_PAGE, 257, 8, buffer);
+    CHECK_EQ(backing.blockReadCount(), 1);
+}
+
+static void testUpdateFlushesAfterQuietPeriod() {
+    MemoryCVAccess backing;
+    ShadowCVAccess shadow(backing, 500);
+    shadow.writeCV(CV_MAXIMUM_SPEED, 200);
+    shadow.update(300);
+    shadow.writeCV(CV_MAXIMUM_SPEED, 210); // Restarts the quiet period
+    shadow.update(300);
+    CHECK_EQ(backing.writeCount(), 0);
+    shadow.update(200);
+    CHECK_EQ(backing.writeCount(), 1);
+    CHECK_EQ(backing.readCV(CV_MAXIMUM_SPEED), 210);
+}
+
+int main() {
+    RUN_TEST(testReadsAreServedFromRam);
+    RUN_TEST(testWritesAreCoalescedUntilFlush);
+    RUN_TEST(testBlockReadPrefersCachedValues);
+    RUN_TEST(testUpdateFlushesAfterQuietPeriod);
+    return TEST_MAIN_RESULT();
+}
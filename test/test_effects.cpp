@@ -0,0 +1,145 @@
+#include <Arduino.h>
+#include <FastLED.h>
+#include <MemoryCVAccess.h>
+#include "xDuinoRails_DccLightsAndFunctions.h"
+#include "cv_definitions.h"
+#include "LightSources/SingleLed.h"
+#include "TestSupport.h"
+
+using namespace xDuinoRails;
+
+static void testStrobeReportsNextEdge() {
+    EffectStrobe strobe(10, 30, 255); // 100 ms period, 30 ms on
+    std::vector<PhysicalOutput*> outputs;
+    CHECK_EQ(strobe.nextUpdateMs(), UPDATE_IDLE);
+    strobe.setActive(true);
+    strobe.update(0, outputs);
+    CHECK_EQ(strobe.nextUpdateMs(), 30);
+    strobe.update(30, outputs);
+    CHECK_EQ(strobe.nextUpdateMs(), 70);
+}
+
+static void testIdleEffectIsSkipped() {
+    PhysicalOutput output(std::unique_ptr<LightSource>(new SingleLed(3)));
+    output.begin();
+    LogicalFunction lf(new EffectSteady(255));
+    lf.addOutput(&output);
+    lf.setActive(true);
+    CHECK_EQ(lf.update(10), UPDATE_IDLE);
+    output.commit();
+    CHECK_EQ(VirtualHardware::pinValue(3), 255);
+
+    for (int i = 0; i < 10; ++i) CHECK_EQ(lf.update(10), UPDATE_IDLE);
+    CHECK_EQ(output.getElidedWriteCount(), 0); // The effect never ran again
+
+    lf.setActive(false);
+    lf.update(10);
+    output.commit();
+    CHECK_EQ(VirtualHardware::pinValue(3), 0);
+}
+
+static void testSkippedTimeIsAccumulated() {
+    PhysicalOutput output(std::unique_ptr<LightSource>(new SingleLed(3)));
+    output.begin();
+    LogicalFunction lf(new EffectStrobe(10, 30, 255));
+    lf.addOutput(&output);
+    lf.setActive(true);
+    CHECK_EQ(lf.update(1), 29);
+    CHECK_EQ(lf.update(10), 19);
+    CHECK_EQ(lf.update(10), 9);
+    output.commit();
+    CHECK_EQ(VirtualHardware::pinValue(3), 255);
+    CHECK_EQ(lf.update(10), 69); // Runs with the 30 ms skipped since the last run
+    output.commit();
+    CHECK_EQ(VirtualHardware::pinValue(3), 0);
+}
+
+static void loadF0ToOutput1(AuxController& controller, uint8_t effect_type) {
+    MemoryCVAccess cvs;
+    cvs.writeCV(CV_FUNCTION_MAPPING_METHOD, (uint8_t)FunctionMappingMethod::RCN_225);
+    cvs.writeCV(CV_OUTPUT_LOCATION_CONFIG_START, 1 << 0);
+    cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, 257 + EFFECTS_CV_OFFSET_TYPE, effect_type);
+    cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, 257 + EFFECTS_CV_OFFSET_PARAM1_LSB, 10);
+    cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, 257 + EFFECTS_CV_OFFSET_PARAM2_LSB, 50);
+    cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, 257 + EFFECTS_CV_OFFSET_PARAM3_LSB, 255);
+    controller.loadFromCVs(cvs);
+}
+
+static void testControllerReportsEarliestDeadline() {
+    AuxController steady;
+    steady.addPhysicalOutput(3, OutputType::LIGHT_SOURCE);
+    loadF0ToOutput1(steady, EFFECT_TYPE_NONE);
+    steady.setFunctionState(0, true);
+    CHECK_EQ(steady.update(10), UPDATE_IDLE);
+    CHECK_EQ(VirtualHardware::pinValue(3), 255);
+
+    AuxController strobe;
+    strobe.addPhysicalOutput(4, OutputType::LIGHT_SOURCE);
+    loadF0ToOutput1(strobe, EFFECT_TYPE_STROBE); // 10 Hz, 50 % duty
+    strobe.setFunctionState(0, true);
+    CHECK_EQ(strobe.update(10), 40);
+    CHECK_EQ(strobe.update(40), 50);
+    CHECK_EQ(VirtualHardware::pinValue(4), 0);
+}
+
+// Records the pin of a controller driving F0 on output 1 with a flicker effect.
+static std::vector<int> recordFlicker(uint8_t pin, uint32_t seed) {
+    AuxController controller;
+    controller.addPhysicalOutput(pin, OutputType::LIGHT_SOURCE);
+    MemoryCVAccess cvs;
+    cvs.writeCV(CV_FUNCTION_MAPPING_METHOD, (uint8_t)FunctionMappingMethod::RCN_225);
+    cvs.writeCV(CV_OUTPUT_LOCATION_CONFIG_START, 1 << 0);
+    cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, 257 + EFFECTS_CV_OFFSET_TYPE, EFFECT_TYPE_FLICKER);
+    cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, 257 + EFFECTS_CV_OFFSET_PARAM1_LSB, 128); // Base
+    cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, 257 + EFFECTS_CV_OFFSET_PARAM2_LSB, 200); // Depth
+    cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, 257 + EFFECTS_CV_OFFSET_PARAM3_LSB, 255); // Speed
+    controller.loadFromCVs(cvs);
+    controller.setBrightnessCurve(1, BrightnessCurve::LINEAR);
+    controller.setRandomSeed(seed);
+    controller.setFunctionState(0, true);
+    std::vector<int> values;
+    for (int i = 0; i < 50; ++i) {
+        controller.update(10);
+        values.push_back(VirtualHardware::pinValue(pin));
+    }
+    return values;
+}
+
+static void testEffectsReplayFromTheControllerSeed() {
+    random16_set_seed(1234);
+    uint16_t expected = random16();
+    random16_set_seed(1234);
+
+    std::vector<int> first = recordFlicker(3, 7);
+    CHECK(first == recordFlicker(4, 7));
+    CHECK(first != recordFlicker(5, 8));
+    CHECK_EQ(random16(), expected); // Effects leave the global generator alone
+}
+
+static void testMarsLightRunsOnControllerTime() {
+    AuxController controller;
+    controller.addPhysicalOutput(3, OutputType::LIGHT_SOURCE);
+    loadF0ToOutput1(controller, EFFECT_TYPE_MARS_LIGHT); // 60 mHz, peak 50
+    controller.setBrightnessCurve(1, BrightnessCurve::LINEAR);
+    controller.setFunctionState(0, true);
+    uint32_t start_ms = millis();
+
+    // Two hours of layout time in one step, without waiting for the wall clock.
+    const uint32_t two_hours = 2UL * 3600 * 1000 + 1234;
+    controller.update(two_hours);
+    CHECK_EQ(controller.nowMs(), two_hours);
+    CHECK_EQ(millis(), start_ms);
+    // The same point of the wave beatsin8() gives at that millis().
+    VirtualHardware::advanceMillis(two_hours - start_ms);
+    CHECK_EQ(VirtualHardware::pinValue(3), beatsin8(1, 0, 50, 0, (uint8_t)map(-1, 0, 100, 0, 255)));
+}
+
+int main() {
+    RUN_TEST(testStrobeReportsNextEdge);
+    RUN_TEST(testIdleEffectIsSkipped);
+    RUN_TEST(testSkippedTimeIsAccumulated);
+    RUN_TEST(testControllerReportsEarliestDeadline);
+    RUN_TEST(testEffectsReplayFromTheControllerSeed);
+    RUN_TEST(testMarsLightRunsOnControllerTime);
+    return TEST_MAIN_RESULT();
+}
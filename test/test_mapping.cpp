@@ -0,0 +1,922 @@
+#include <Arduino.h>
+#include <MemoryCVAccess.h>
+#include "xDuinoRails_DccLightsAndFunctions.h"
+#include "ShadowCVAccess.h"
+#include "cv_definitions.h"
+#include "effects/Effect.h"
+#include "TestSupport.h"
+#include <cstdlib>
+
+using namespace xDuinoRails;
+
+// Output n (1-based, as used by the mapping CVs) is driven through pin 10 + n.
+static const int kNumOutputs = 32;
+
+static void addOutputs(AuxController& controller) {
+    for (int output = 1; output <= kNumOutputs; ++output) {
+        controller.addPhysicalOutput((uint8_t)(10 + output), OutputType::LIGHT_SOURCE);
+        controller.setBrightnessCurve((uint8_t)output, BrightnessCurve::LINEAR); // Pins show effect levels
+    }
+}
+
+static bool outputOn(int output) {
+    return VirtualHardware::pinValue((uint8_t)(10 + output)) != 0;
+}
+
+static void testConditionStateSetMasks() {
+    ConditionStateSet states;
+    states.resize(70);
+    states.set(3, true);
+    states.set(40, true);
+    states.set(69, true);
+    std::vector<ConditionMask> all = ConditionStateSet::makeMasks({69, 3, 40});
+    CHECK_EQ(all.size(), 3);
+    CHECK(states.allSet(all));
+    CHECK(!states.noneSet(all));
+    states.set(40, false);
+    CHECK(!states.allSet(all));
+    CHECK(states.noneSet(ConditionStateSet::makeMasks({40, 41})));
+    CHECK_EQ(ConditionStateSet::makeMasks({1, 2, 31}).size(), 1);
+}
+
+static void testRcn225() {
+    AuxController controller;
+    addOutputs(controller);
+    MemoryCVAccess cvs;
+    cvs.writeCV(CV_FUNCTION_MAPPING_METHOD, (uint8_t)FunctionMappingMethod::RCN_225);
+    cvs.writeCV(CV_OUTPUT_LOCATION_CONFIG_START, 1 << 0);     // F0f -> output 1
+    cvs.writeCV(CV_OUTPUT_LOCATION_CONFIG_START + 1, 1 << 1); // F0r -> output 2
+    cvs.writeCV(CV_OUTPUT_LOCATION_CONFIG_START + 3, 1 << 4); // F2 -> output 5
+    controller.loadFromCVs(cvs);
+
+    controller.setFunctionState(0, true);
+    controller.setDirection(DECODER_DIRECTION_REVERSE);
+    controller.update(10);
+    CHECK(!outputOn(1));
+    CHECK(outputOn(2));
+    CHECK(!controller.getConditionVariableState(999));
+
+    controller.setFunctionState(2, true);
+    controller.update(10);
+    CHECK(outputOn(5));
+}
+
+static void testRcn227PerFunctionBlocking() {
+    AuxController controller;
+    addOutputs(controller);
+    MemoryCVAccess cvs;
+    cvs.writeCV(CV_FUNCTION_MAPPING_METHOD, (uint8_t)FunctionMappingMethod::RCN_227_PER_FUNCTION);
+    // F3 forward -> output 4, blocked by F7.
+    uint16_t base = 257 + (3 * 2 + 0) * 4;
+    cvs.writeIndexedCV(RCN227_PER_FUNCTION_PAGE, base, 1 << 3);
+    cvs.writeIndexedCV(RCN227_PER_FUNCTION_PAGE, base + 3, 7);
+    // F4 forward -> output 5, also blocked by F7 (duplicate blocking condition).
+    base = 257 + (4 * 2 + 0) * 4;
+    cvs.writeIndexedCV(RCN227_PER_FUNCTION_PAGE, base, 1 << 4);
+    cvs.writeIndexedCV(RCN227_PER_FUNCTION_PAGE, base + 3, 7);
+    controller.loadFromCVs(cvs);
+
+    controller.setFunctionState(7, true);
+    controller.setFunctionState(3, true);
+    controller.update(10);
+    CHECK(!outputOn(4));
+
+    controller.setFunctionState(7, false);
+    controller.setFunctionState(4, true);
+    controller.update(10);
+    CHECK(outputOn(4));
+    CHECK(outputOn(5));
+}
+
+static void testRcn227PerOutputV1WideMatrix() {
+    AuxController controller;
+    addOutputs(controller);
+    MemoryCVAccess cvs;
+    cvs.writeCV(CV_FUNCTION_MAPPING_METHOD, (uint8_t)FunctionMappingMethod::RCN_227_PER_OUTPUT_V1);
+    // Outputs 1-23 respond to every function in both directions; output 24 only to F28 in reverse.
+    for (int output = 0; output < 23; ++output) {
+        for (int dir = 0; dir < 2; ++dir) {
+            for (int i = 0; i < 4; ++i) cvs.writeIndexedCV(RCN227_PER_OUTPUT_V1_PAGE, 257 + (output * 2 + dir) * 4 + i, 0xFF);
+        }
+    }
+    cvs.writeIndexedCV(RCN227_PER_OUTPUT_V1_PAGE, 257 + (23 * 2 + 1) * 4 + 3, 1 << (28 - 24));
+    controller.loadFromCVs(cvs);
+
+    controller.setFunctionState(28, true);
+    controller.setDirection(DECODER_DIRECTION_REVERSE);
+    controller.update(10);
+    CHECK(outputOn(1));
+    CHECK(outputOn(23));
+    CHECK(outputOn(24));
+    // One term per output keeps the masks instead of one condition per set bit.
+    CHECK_EQ(controller._mask_terms.size(), 24);
+    CHECK(controller._condition_variables.empty());
+}
+
+static void testRcn227PerOutputV2() {
+    AuxController controller;
+    addOutputs(controller);
+    MemoryCVAccess cvs;
+    cvs.writeCV(CV_FUNCTION_MAPPING_METHOD, (uint8_t)FunctionMappingMethod::RCN_227_PER_OUTPUT_V2);
+    for (int cv = 257; cv <= 512; ++cv) cvs.writeIndexedCV(RCN227_PER_OUTPUT_V2_PAGE, cv, 255);
+    // Output 6: F5 forward, blocked by F9.
+    uint16_t base = 257 + (5 * 2 + 0) * 4;
+    cvs.writeIndexedCV(RCN227_PER_OUTPUT_V2_PAGE, base, 5);
+    cvs.writeIndexedCV(RCN227_PER_OUTPUT_V2_PAGE, base + 3, 9);
+    controller.loadFromCVs(cvs);
+
+    controller.setFunctionState(5, true);
+    controller.setFunctionState(9, true);
+    controller.update(10);
+    CHECK(!outputOn(6));
+    controller.setFunctionState(9, false);
+    controller.update(10);
+    CHECK(outputOn(6));
+}
+
+static void testRcn227PerOutputV3() {
+    AuxController controller;
+    addOutputs(controller);
+    MemoryCVAccess cvs;
+    cvs.writeCV(CV_FUNCTION_MAPPING_METHOD, (uint8_t)FunctionMappingMethod::RCN_227_PER_OUTPUT_V3);
+    for (int cv = 257; cv <= 512; ++cv) cvs.writeIndexedCV(RCN227_PER_OUTPUT_V3_PAGE, cv, 255);
+    // Output 3: F0 reverse activates, F1 (any direction) blocks.
+    uint16_t base = 257 + 2 * 8;
+    cvs.writeIndexedCV(RCN227_PER_OUTPUT_V3_PAGE, base, (0x02 << 6) | 0);
+    cvs.writeIndexedCV(RCN227_PER_OUTPUT_V3_PAGE, base + 1, (0x03 << 6) | 1);
+    controller.loadFromCVs(cvs);
+
+    controller.setFunctionState(0, true);
+    controller.setDirection(DECODER_DIRECTION_FORWARD);
+    controller.update(10);
+    CHECK(!outputOn(3));
+    controller.setDirection(DECODER_DIRECTION_REVERSE);
+    controller.update(10);
+    CHECK(outputOn(3));
+}
+
+static void testFunctionMaskTerm() {
+    FunctionMaskTerm term = {};
+    term.function_mask[DECODER_DIRECTION_FORWARD] = (1u << 0) | (1u << 5);
+    term.function_mask[DECODER_DIRECTION_REVERSE] = 1u << 6;
+    term.blocking_mask = 1u << 9;
+    CHECK(term.evaluate(1u << 5, DECODER_DIRECTION_FORWARD));
+    CHECK(!term.evaluate(1u << 5, DECODER_DIRECTION_REVERSE));
+    CHECK(term.evaluate(1u << 6, DECODER_DIRECTION_REVERSE));
+    CHECK(!term.evaluate((1u << 0) | (1u << 9), DECODER_DIRECTION_FORWARD));
+    CHECK_EQ(term.inputs(), (1u << 0) | (1u << 5) | (1u << 6) | (1u << 9));
+}
+
+static void testIncrementalEvaluationMatchesFullEvaluation() {
+    AuxController controller;
+    addOutputs(controller);
+    MemoryCVAccess cvs;
+    cvs.writeCV(CV_FUNCTION_MAPPING_METHOD, (uint8_t)FunctionMappingMethod::RCN_227_PER_OUTPUT_V3);
+    for (int output = 0; output < kNumOutputs; ++output) {
+        uint16_t base = 257 + output * 8;
+        for (int i = 0; i < 4; ++i) {
+            cvs.writeIndexedCV(RCN227_PER_OUTPUT_V3_PAGE, base + i, (uint8_t)(((i % 4) << 6) | ((output + i * 5) % 29)));
+        }
+        cvs.writeIndexedCV(RCN227_PER_OUTPUT_V3_PAGE, base + 4, 0x00);
+        cvs.writeIndexedCV(RCN227_PER_OUTPUT_V3_PAGE, base + 5, 69 + output % 4); // binary state
+        cvs.writeIndexedCV(RCN227_PER_OUTPUT_V3_PAGE, base + 6, 255);
+        cvs.writeIndexedCV(RCN227_PER_OUTPUT_V3_PAGE, base + 7, 255);
+    }
+    controller.loadFromCVs(cvs);
+    controller.update(1);
+
+    srand(7);
+    for (int step = 0; step < 300; ++step) {
+        switch (rand() % 3) {
+            case 0: controller.setFunctionState((uint8_t)(rand() % MAX_DCC_FUNCTIONS), rand() % 2); break;
+            case 1: controller.setDirection(rand() % 2 ? DECODER_DIRECTION_FORWARD : DECODER_DIRECTION_REVERSE); break;
+            default: controller.setBinaryState((uint16_t)(rand() % 4), rand() % 2); break;
+        }
+        controller.update(1);
+        std::vector<bool> incremental, active;
+        for (const auto& cv : controller._condition_variables) incremental.push_back(controller.getConditionVariableState(cv.id));
+        for (const auto* lf : controller._logical_functions) active.push_back(lf->isActive());
+        controller._evaluate_all = true;
+        controller.evaluateMapping();
+        for (size_t i = 0; i < incremental.size(); ++i) {
+            CHECK_EQ(incremental[i], controller.getConditionVariableState(controller._condition_variables[i].id));
+        }
+        for (size_t i = 0; i < active.size(); ++i) CHECK_EQ(active[i], controller.getLogicalFunction(i)->isActive());
+    }
+}
+
+// Adds a ConditionVariable that is true while the function is on.
+static uint16_t addFunctionCondition(AuxController& controller, uint16_t id, uint8_t function) {
+    ConditionVariable cv;
+    cv.id = id;
+    cv.conditions.push_back({TriggerSource::FUNC_KEY, TriggerComparator::IS_TRUE, function});
+    return controller.addConditionVariable(cv);
+}
+
+static void addRule(AuxController& controller, uint8_t target, uint16_t cv_id, MappingAction action) {
+    MappingRule rule;
+    rule.target_logical_function_id = target;
+    rule.positive_conditions.push_back(cv_id);
+    rule.action = action;
+    controller.addMappingRule(rule);
+}
+
+static void testLevelAndToggleActions() {
+    AuxController controller;
+    addOutputs(controller);
+    for (uint8_t output = 1; output <= 2; ++output) {
+        LogicalFunction* lf = new LogicalFunction(new EffectDimming(200, 50));
+        lf->addOutput(controller.getOutputById(output));
+        controller.addLogicalFunction(lf);
+    }
+    // Output 1 is on while F1 or F2, off while F3, dimmed while F4. F5 toggles output 2, F6 its dimming.
+    addRule(controller, 0, addFunctionCondition(controller, 1, 1), MappingAction::ACTIVATE);
+    addRule(controller, 0, addFunctionCondition(controller, 2, 2), MappingAction::ACTIVATE);
+    addRule(controller, 0, addFunctionCondition(controller, 3, 3), MappingAction::DEACTIVATE);
+    addRule(controller, 0, addFunctionCondition(controller, 4, 4), MappingAction::SET_DIMMED);
+    addRule(controller, 1, addFunctionCondition(controller, 5, 5), MappingAction::TOGGLE_ACTIVE);
+    addRule(controller, 1, addFunctionCondition(controller, 6, 6), MappingAction::TOGGLE_DIMMED);
+    controller.compileMapping();
+    controller.update(1);
+
+    controller.setFunctionState(1, true);
+    controller.update(1);
+    CHECK_EQ(VirtualHardware::pinValue(11), 200);
+    // A second activating rule changes nothing, so the effect is not even re-run.
+    uint32_t elided = controller.getElidedWriteCount();
+    controller.setFunctionState(2, true);
+    controller.update(1);
+    CHECK_EQ(controller.getElidedWriteCount(), elided);
+    controller.setFunctionState(1, false);
+    controller.update(1);
+    CHECK_EQ(VirtualHardware::pinValue(11), 200);
+    controller.setFunctionState(2, false);
+    controller.update(1);
+    CHECK_EQ(VirtualHardware::pinValue(11), 0);
+
+    controller.setFunctionState(1, true);
+    controller.setFunctionState(3, true);
+    controller.update(1);
+    CHECK_EQ(VirtualHardware::pinValue(11), 0);
+    controller.setFunctionState(3, false);
+    controller.setFunctionState(4, true);
+    controller.update(1);
+    CHECK_EQ(VirtualHardware::pinValue(11), 50);
+    controller.update(1); // Dimming is a level, not a toggle per evaluation.
+    CHECK_EQ(VirtualHardware::pinValue(11), 50);
+
+    controller.setFunctionState(5, true);
+    controller.update(1);
+    CHECK_EQ(VirtualHardware::pinValue(12), 200);
+    controller.setFunctionState(5, false);
+    controller.update(1);
+    CHECK_EQ(VirtualHardware::pinValue(12), 200);
+    controller.setFunctionState(5, true);
+    controller.update(1);
+    CHECK_EQ(VirtualHardware::pinValue(12), 0);
+
+    // Dimming toggles on the rising edge only, also while the output is off, and is kept
+    // until it is toggled back.
+    controller.setFunctionState(6, true);
+    controller.update(1);
+    CHECK_EQ(VirtualHardware::pinValue(12), 0);
+    CHECK(controller.getLogicalFunction(1)->isDimmed());
+    controller.setFunctionState(5, false);
+    controller.update(1);
+    controller.setFunctionState(5, true);
+    controller.update(1);
+    CHECK_EQ(VirtualHardware::pinValue(12), 50);
+    controller.setFunctionState(6, false);
+    controller.update(1);
+    CHECK_EQ(VirtualHardware::pinValue(12), 50);
+    controller.setFunctionState(6, true);
+    controller.update(1);
+    CHECK_EQ(VirtualHardware::pinValue(12), 200);
+    // Both toggle rules true in one evaluation: each fires once.
+    controller.setFunctionState(5, false);
+    controller.setFunctionState(6, false);
+    controller.update(1);
+    controller.setFunctionState(5, true);
+    controller.setFunctionState(6, true);
+    controller.update(1);
+    CHECK_EQ(VirtualHardware::pinValue(12), 0);
+    CHECK(controller.getLogicalFunction(1)->isDimmed());
+}
+
+static void testLogicalFunctionStateSettlesInOneUpdate() {
+    AuxController controller;
+    addOutputs(controller);
+    for (uint8_t output = 1; output <= 2; ++output) {
+        LogicalFunction* lf = new LogicalFunction(new EffectSteady(255));
+        lf->addOutput(controller.getOutputById(output));
+        controller.addLogicalFunction(lf);
+    }
+    // Output 2 follows output 1, which follows F1.
+    addRule(controller, 0, addFunctionCondition(controller, 1, 1), MappingAction::ACTIVATE);
+    ConditionVariable follows;
+    follows.id = 2;
+    follows.conditions.push_back({TriggerSource::LOGICAL_FUNC_STATE, TriggerComparator::IS_TRUE, 0});
+    addRule(controller, 1, controller.addConditionVariable(follows), MappingAction::ACTIVATE);
+    controller.compileMapping();
+    controller.update(1);
+
+    controller.setFunctionState(1, true);
+    CHECK_EQ(controller.update(1), UPDATE_IDLE);
+    CHECK(outputOn(1));
+    CHECK(outputOn(2));
+    controller.setFunctionState(1, false);
+    controller.update(1);
+    CHECK(!outputOn(2));
+}
+
+static void testUnreadInputsDoNotTriggerEvaluation() {
+    AuxController controller;
+    addOutputs(controller);
+    MemoryCVAccess cvs;
+    cvs.writeCV(CV_FUNCTION_MAPPING_METHOD, (uint8_t)FunctionMappingMethod::RCN_225);
+    cvs.writeCV(CV_OUTPUT_LOCATION_CONFIG_START + 2, 1); // F1 -> output 1
+    controller.loadFromCVs(cvs);
+    controller.update(1);
+    CHECK(!controller._state_changed);
+
+    controller.setFunctionState(9, true);
+    controller.setSpeed(40);
+    CHECK(!controller._state_changed);
+    controller.setFunctionState(1, true);
+    CHECK(controller._state_changed);
+}
+
+// Implements only readCV()/writeCV(), so loading goes through the default readCVs().
+class ByteCVAccess : public ICVAccess {
+public:
+    explicit ByteCVAccess(MemoryCVAccess& backing) : _backing(backing) {}
+    uint8_t readCV(uint16_t cv_number) override { return _backing.readCV(cv_number); }
+    void writeCV(uint16_t cv_number, uint8_t value) override {
+        if (cv_number == CV_INDEXED_CV_HIGH_BYTE || cv_number == CV_INDEXED_CV_LOW_BYTE) ++page_writes;
+        _backing.writeCV(cv_number, value);
+    }
+    int page_writes = 0;
+private:
+    MemoryCVAccess& _backing;
+};
+
+static void testLoadFetchesEachPageOnce() {
+    MemoryCVAccess cvs;
+    cvs.writeCV(CV_FUNCTION_MAPPING_METHOD, (uint8_t)FunctionMappingMethod::RCN_227_PER_OUTPUT_V3);
+    for (int cv = 257; cv <= 512; ++cv) cvs.writeIndexedCV(RCN227_PER_OUTPUT_V3_PAGE, cv, 255);
+    for (int output = 0; output < kNumOutputs; ++output) {
+        cvs.writeIndexedCV(RCN227_PER_OUTPUT_V3_PAGE, 257 + output * 8, (uint8_t)output);
+        cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, 257 + output * 8 + EFFECTS_CV_OFFSET_TYPE, EFFECT_TYPE_DIMMING);
+        cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, 257 + output * 8 + EFFECTS_CV_OFFSET_PARAM1_LSB, 200);
+    }
+
+    AuxController controller;
+    addOutputs(controller);
+    cvs.resetCounters();
+    controller.loadFromCVs(cvs);
+    CHECK_EQ(cvs.blockReadCount(), 2);
+    CHECK_EQ(cvs.readCount(), 1); // CV96 only
+    CHECK_EQ(cvs.writeCount(), 0);
+    CHECK_EQ(controller._standby.logical_functions.size(), kNumOutputs);
+
+    // The default readCVs() switches to each page once: effects, then the mapping page.
+    ByteCVAccess bytes(cvs);
+    controller.loadFromCVs(bytes);
+    CHECK_EQ(bytes.page_writes, 2);
+    CHECK_EQ(cvs.readIndexedCV(0, CV_INDEXED_CV_LOW_BYTE), RCN227_PER_OUTPUT_V3_PAGE);
+    CHECK_EQ(controller._standby.logical_functions.size(), kNumOutputs);
+    controller.setFunctionState(5, true);
+    controller.update(1);
+    CHECK_EQ(VirtualHardware::pinValue(16), 200);
+}
+
+static void testShadowedLoadDoesNotWriteBackingStore() {
+    MemoryCVAccess cvs;
+    cvs.writeCV(CV_FUNCTION_MAPPING_METHOD, (uint8_t)FunctionMappingMethod::RCN_227_PER_OUTPUT_V3);
+    for (int cv = 257; cv <= 512; ++cv) cvs.writeIndexedCV(RCN227_PER_OUTPUT_V3_PAGE, cv, 255);
+    cvs.writeIndexedCV(RCN227_PER_OUTPUT_V3_PAGE, 257, 0); // F0 -> output 1
+    cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, 257 + EFFECTS_CV_OFFSET_TYPE, EFFECT_TYPE_DIMMING);
+    cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, 257 + EFFECTS_CV_OFFSET_PARAM1_LSB, 200);
+    cvs.writeCV(CV_INDEXED_CV_LOW_BYTE, 7); // Some unrelated page is selected
+
+    AuxController controller;
+    addOutputs(controller);
+    cvs.resetCounters();
+    ShadowCVAccess shadow(cvs);
+    controller.loadFromCVs(shadow);
+    shadow.flush();
+    CHECK_EQ(cvs.writeCount(), 0);
+
+    // With the default readCVs() the backing store switches pages, and gets its selection back.
+    uint32_t changes = cvs.changeCounter();
+    ByteCVAccess bytes(cvs);
+    ShadowCVAccess byte_shadow(bytes);
+    controller.loadFromCVs(byte_shadow);
+    byte_shadow.flush();
+    CHECK_EQ(cvs.writeCount(), bytes.page_writes);
+    CHECK_EQ(cvs.readCV(CV_INDEXED_CV_HIGH_BYTE), 0);
+    CHECK_EQ(cvs.readCV(CV_INDEXED_CV_LOW_BYTE), 7);
+    CHECK_EQ(cvs.changeCounter() - changes, (uint32_t)bytes.page_writes);
+    controller.setFunctionState(0, true);
+    controller.update(1);
+    CHECK_EQ(VirtualHardware::pinValue(11), 200);
+}
+
+// A few mappings per method, with blocking functions and binary states where supported.
+static void writeMixedMapping(MemoryCVAccess& cvs, FunctionMappingMethod method) {
+    cvs.writeCV(CV_FUNCTION_MAPPING_METHOD, (uint8_t)method);
+    for (int output = 0; output < kNumOutputs; ++output) {
+        cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, 257 + output * 8 + EFFECTS_CV_OFFSET_TYPE, (uint8_t)(output % 3));
+        cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, 257 + output * 8 + EFFECTS_CV_OFFSET_PARAM1_LSB, 200);
+    }
+    switch (method) {
+        case FunctionMappingMethod::RCN_225:
+            for (int i = 0; i < 14; ++i) cvs.writeCV(CV_OUTPUT_LOCATION_CONFIG_START + i, (uint8_t)(0x11 << (i % 4)));
+            break;
+        case FunctionMappingMethod::RCN_227_PER_FUNCTION:
+            for (int f = 0; f < 12; ++f) {
+                uint16_t base = 257 + (f * 2 + f % 2) * 4;
+                cvs.writeIndexedCV(RCN227_PER_FUNCTION_PAGE, base, (uint8_t)(1 << (f % 8)));
+                cvs.writeIndexedCV(RCN227_PER_FUNCTION_PAGE, base + 3, (uint8_t)(f % 3 == 0 ? 20 + f : 255));
+            }
+            break;
+        case FunctionMappingMethod::RCN_227_PER_OUTPUT_V1:
+            for (int output = 0; output < 24; ++output) {
+                cvs.writeIndexedCV(RCN227_PER_OUTPUT_V1_PAGE, 257 + (output * 2 + output % 2) * 4, (uint8_t)(output * 37));
+            }
+            break;
+        case FunctionMappingMethod::RCN_227_PER_OUTPUT_V2:
+            for (int cv = 257; cv <= 512; ++cv) cvs.writeIndexedCV(RCN227_PER_OUTPUT_V2_PAGE, cv, 255);
+            for (int output = 0; output < kNumOutputs; ++output) {
+                uint16_t base = 257 + (output * 2 + output % 2) * 4;
+                cvs.writeIndexedCV(RCN227_PER_OUTPUT_V2_PAGE, base, (uint8_t)(output % 29));
+                cvs.writeIndexedCV(RCN227_PER_OUTPUT_V2_PAGE, base + 3, (uint8_t)(output % 4 == 0 ? (output + 7) % 29 : 255));
+            }
+            break;
+        default:
+            for (int output = 0; output < kNumOutputs; ++output) {
+                uint16_t base = 257 + output * 8;
+                for (int i = 0; i < 4; ++i) {
+                    cvs.writeIndexedCV(RCN227_PER_OUTPUT_V3_PAGE, base + i, (uint8_t)(((i % 4) << 6) | ((output + i * 5) % 29)));
+                }
+                cvs.writeIndexedCV(RCN227_PER_OUTPUT_V3_PAGE, base + 4, 0x00);
+                cvs.writeIndexedCV(RCN227_PER_OUTPUT_V3_PAGE, base + 5, 69 + output % 4);
+                cvs.writeIndexedCV(RCN227_PER_OUTPUT_V3_PAGE, base + 6, 255);
+                cvs.writeIndexedCV(RCN227_PER_OUTPUT_V3_PAGE, base + 7, 255);
+            }
+            break;
+    }
+}
+
+static void testMappingImageRoundTrip() {
+    const FunctionMappingMethod methods[] = {
+        FunctionMappingMethod::RCN_225,
+        FunctionMappingMethod::RCN_227_PER_FUNCTION,
+        FunctionMappingMethod::RCN_227_PER_OUTPUT_V1,
+        FunctionMappingMethod::RCN_227_PER_OUTPUT_V2,
+        FunctionMappingMethod::RCN_227_PER_OUTPUT_V3,
+    };
+    for (FunctionMappingMethod method : methods) {
+        MemoryCVAccess cvs;
+        writeMixedMapping(cvs, method);
+        AuxController parsed, restored;
+        addOutputs(parsed);
+        addOutputs(restored);
+        parsed.loadFromCVs(cvs);
+        std::vector<uint8_t> image;
+        CHECK(parsed.saveMappingImage(cvs, image));
+
+        cvs.resetCounters();
+        CHECK(restored.loadFromImage(cvs, image));
+        CHECK_EQ(cvs.writeCount(), 0);
+        // The change counter still matches: only CV96 is read, no page and no effect CV.
+        CHECK_EQ(cvs.readCount(), 1);
+        CHECK_EQ(cvs.blockReadCount(), 0);
+        restored.update(0);
+        CHECK_EQ(restored._logical_functions.size(), parsed._logical_functions.size());
+        CHECK_EQ(restored._condition_variables.size(), parsed._condition_variables.size());
+        CHECK_EQ(restored._mapping_rules.size(), parsed._mapping_rules.size());
+        CHECK_EQ(restored._mask_terms.size(), parsed._mask_terms.size());
+
+        int active = 0;
+        srand(11);
+        for (int step = 0; step < 100; ++step) {
+            uint8_t f = (uint8_t)(rand() % MAX_DCC_FUNCTIONS);
+            bool on = rand() % 2;
+            DecoderDirection dir = rand() % 2 ? DECODER_DIRECTION_FORWARD : DECODER_DIRECTION_REVERSE;
+            uint16_t state = (uint16_t)(rand() % 4);
+            for (AuxController* controller : {&parsed, &restored}) {
+                controller->setFunctionState(f, on);
+                controller->setDirection(dir);
+                controller->setBinaryState(state, on);
+                controller->update(1);
+            }
+            for (size_t i = 0; i < parsed._logical_functions.size(); ++i) {
+                CHECK_EQ(restored.getLogicalFunction(i)->isActive(), parsed.getLogicalFunction(i)->isActive());
+                active += parsed.getLogicalFunction(i)->isActive();
+            }
+        }
+        CHECK(active > 0);
+    }
+}
+
+static void testStaleOrCorruptImageIsRejected() {
+    MemoryCVAccess cvs;
+    writeMixedMapping(cvs, FunctionMappingMethod::RCN_227_PER_OUTPUT_V3);
+    AuxController controller;
+    addOutputs(controller);
+    controller.loadFromCVs(cvs);
+    std::vector<uint8_t> image;
+    CHECK(controller.saveMappingImage(cvs, image));
+
+    std::vector<uint8_t> corrupt = image;
+    corrupt[corrupt.size() / 2] ^= 0x40;
+    CHECK(!controller.loadFromImage(cvs, corrupt));
+    corrupt = image;
+    corrupt[2] = MAPPING_IMAGE_VERSION + 1;
+    CHECK(!controller.loadFromImage(cvs, corrupt));
+    corrupt.assign(image.begin(), image.begin() + 8);
+    CHECK(!controller.loadFromImage(cvs, corrupt));
+
+    // An effect parameter changed since the image was saved.
+    cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, 257 + 5 * 8 + EFFECTS_CV_OFFSET_PARAM1_LSB, 100);
+    CHECK(!controller.loadFromImage(cvs, image));
+    std::vector<uint8_t> stale;
+    CHECK(!controller.saveMappingImage(cvs, stale)); // The loaded mapping no longer matches the CVs
+    CHECK(stale.empty());
+    // Changed back: the counter moved on, so the CVs are hashed, and they match again.
+    cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, 257 + 5 * 8 + EFFECTS_CV_OFFSET_PARAM1_LSB, 200);
+    cvs.resetCounters();
+    CHECK(controller.loadFromImage(cvs, image));
+    CHECK(cvs.blockReadCount() > 0);
+}
+
+// Every RCN-227 per-output V2 slot in use, as in the benchmark: three functions and a blocking
+// function per output and direction.
+static void writeMaximumV2Mapping(MemoryCVAccess& cvs) {
+    cvs.writeCV(CV_FUNCTION_MAPPING_METHOD, (uint8_t)FunctionMappingMethod::RCN_227_PER_OUTPUT_V2);
+    for (int entry = 0; entry < 64; ++entry) {
+        uint16_t base = 257 + entry * 4;
+        for (int i = 0; i < 3; ++i) cvs.writeIndexedCV(RCN227_PER_OUTPUT_V2_PAGE, base + i, (uint8_t)((entry + i) % 29));
+        cvs.writeIndexedCV(RCN227_PER_OUTPUT_V2_PAGE, base + 3, (uint8_t)(28 - entry % 29));
+    }
+    for (int output = 0; output < kNumOutputs; ++output) {
+        uint16_t base = 257 + output * EFFECTS_BLOCK_CV_PER_OUTPUT;
+        cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, base + EFFECTS_CV_OFFSET_TYPE, EFFECT_TYPE_DIMMING);
+        cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, base + EFFECTS_CV_OFFSET_PARAM1_LSB, 200);
+    }
+}
+
+// Serves the image the way EEPROM would, recording how it is read.
+class BlockImageSource : public IMappingImageSource {
+public:
+    explicit BlockImageSource(const std::vector<uint8_t>& image) : _image(image) {}
+    size_t size() override { return _image.size(); }
+    void read(size_t offset, uint8_t* buffer, size_t count) override {
+        if (count > largest_read) largest_read = count;
+        bytes_read += count;
+        for (size_t i = 0; i < count; ++i) buffer[i] = _image.at(offset + i);
+    }
+    size_t largest_read = 0;
+    size_t bytes_read = 0;
+private:
+    const std::vector<uint8_t>& _image;
+};
+
+static void testMaximumImageIsCompactAndStreams() {
+    MemoryCVAccess cvs;
+    writeMaximumV2Mapping(cvs);
+    AuxController parsed, restored;
+    addOutputs(parsed);
+    addOutputs(restored);
+    parsed.loadFromCVs(cvs);
+    std::vector<uint8_t> image;
+    CHECK(parsed.saveMappingImage(cvs, image));
+    // 32 logical functions, 87 conditions and 192 rules; one-byte condition indices keep a rule
+    // at six bytes (the version 2 layout took 4081 bytes for this mapping).
+    CHECK_EQ(parsed._mapping_rules.size(), 192);
+    CHECK(image.size() <= 2048);
+
+    // Decoded in small blocks straight from the source: the header once, the payload twice
+    // (hash check, then decoding).
+    BlockImageSource source(image);
+    CHECK(restored.loadFromImage(cvs, source));
+    CHECK(source.largest_read <= MappingImageReader::BLOCK_SIZE);
+    CHECK_EQ(source.bytes_read, 2 * image.size() - MAPPING_IMAGE_HEADER_SIZE);
+    restored.update(0);
+    CHECK_EQ(restored._mapping_rules.size(), parsed._mapping_rules.size());
+    for (uint8_t f = 0; f < 29; f += 4) {
+        for (AuxController* controller : {&parsed, &restored}) {
+            controller->setFunctionState(f, true);
+            controller->update(1);
+        }
+        for (size_t i = 0; i < parsed._logical_functions.size(); ++i) {
+            CHECK_EQ(restored.getLogicalFunction(i)->isActive(), parsed.getLogicalFunction(i)->isActive());
+        }
+    }
+}
+
+static void testOneLogicalFunctionPerOutput() {
+    AuxController controller;
+    addOutputs(controller);
+    MemoryCVAccess cvs;
+    cvs.writeCV(CV_FUNCTION_MAPPING_METHOD, (uint8_t)FunctionMappingMethod::RCN_225);
+    cvs.writeCV(CV_OUTPUT_LOCATION_CONFIG_START, 0x03);     // F0f -> outputs 1 and 2
+    cvs.writeCV(CV_OUTPUT_LOCATION_CONFIG_START + 1, 0x01); // F0r -> output 1
+    cvs.writeCV(CV_OUTPUT_LOCATION_CONFIG_START + 6, 0x01); // F5 -> output 1
+    controller.loadFromCVs(cvs);
+    controller.update(0);
+    CHECK_EQ(controller._logical_functions.size(), 2);
+    CHECK_EQ(controller._mask_terms.size(), 2);
+    controller.setDirection(DECODER_DIRECTION_REVERSE);
+    controller.setFunctionState(5, true);
+    controller.update(1);
+    CHECK(outputOn(1));
+    CHECK(!outputOn(2));
+
+    // Per-function: F1 forward and F2 reverse on output 4, F2 blocked by F9, F1 unblocked.
+    cvs.writeCV(CV_FUNCTION_MAPPING_METHOD, (uint8_t)FunctionMappingMethod::RCN_227_PER_FUNCTION);
+    for (int cv = 257; cv <= 512; ++cv) cvs.writeIndexedCV(RCN227_PER_FUNCTION_PAGE, cv, (cv - 257) % 4 == 3 ? 255 : 0);
+    cvs.writeIndexedCV(RCN227_PER_FUNCTION_PAGE, 257 + (1 * 2 + 0) * 4, 1 << 3);
+    cvs.writeIndexedCV(RCN227_PER_FUNCTION_PAGE, 257 + (2 * 2 + 1) * 4, 1 << 3);
+    cvs.writeIndexedCV(RCN227_PER_FUNCTION_PAGE, 257 + (2 * 2 + 1) * 4 + 3, 9);
+    cvs.writeIndexedCV(RCN227_PER_FUNCTION_PAGE, 257 + (3 * 2 + 1) * 4, 1 << 3);
+    controller.loadFromCVs(cvs);
+    controller.update(0);
+    CHECK_EQ(controller._logical_functions.size(), 1);
+    CHECK_EQ(controller._mask_terms.size(), 2);
+    controller.setFunctionState(9, true);
+    controller.setFunctionState(2, true);
+    controller.update(1);
+    CHECK(!outputOn(4));
+    controller.setFunctionState(3, true);
+    controller.update(1);
+    CHECK(outputOn(4));
+}
+
+static void testIdenticalPredicatesAreShared() {
+    AuxController controller;
+    addOutputs(controller);
+    MemoryCVAccess cvs;
+    cvs.writeCV(CV_FUNCTION_MAPPING_METHOD, (uint8_t)FunctionMappingMethod::RCN_227_PER_OUTPUT_V3);
+    for (int cv = 257; cv <= 512; ++cv) cvs.writeIndexedCV(RCN227_PER_OUTPUT_V3_PAGE, cv, 255);
+    // Every output follows F0 forward; odd outputs are blocked by F8.
+    for (int output = 0; output < kNumOutputs; ++output) {
+        cvs.writeIndexedCV(RCN227_PER_OUTPUT_V3_PAGE, 257 + output * 8, (0x01 << 6) | 0);
+        if (output % 2) cvs.writeIndexedCV(RCN227_PER_OUTPUT_V3_PAGE, 257 + output * 8 + 1, (0x03 << 6) | 8);
+    }
+    controller.loadFromCVs(cvs);
+    controller.update(0);
+    CHECK_EQ(controller._condition_variables.size(), 2);
+    CHECK_EQ(controller._mapping_rules.size(), kNumOutputs);
+
+    controller.setFunctionState(0, true);
+    controller.setFunctionState(8, true);
+    controller.update(1);
+    CHECK(outputOn(1));
+    CHECK(!outputOn(2));
+    CHECK(outputOn(31));
+
+    // Remapping one output gives it its own condition without disturbing the shared one.
+    cvs.writeIndexedCV(RCN227_PER_OUTPUT_V3_PAGE, 257, 3);
+    controller.reloadCV(cvs, RCN227_PER_OUTPUT_V3_PAGE, 257);
+    controller.update(1);
+    CHECK_EQ(controller._condition_variables.size(), 3);
+    controller.setFunctionState(3, true);
+    controller.update(1);
+    CHECK(outputOn(1));
+    CHECK(outputOn(3));
+}
+
+// True if any logical function driving the output is active.
+static bool outputActive(const AuxController& controller, uint8_t output_num) {
+    for (size_t i = 0; i < controller._lf_outputs.size(); ++i) {
+        if (controller._lf_outputs[i] == output_num && controller.getLogicalFunction(i)->isActive()) return true;
+    }
+    return false;
+}
+
+static void testSingleCvWritesMatchFullReload() {
+    const FunctionMappingMethod methods[] = {
+        FunctionMappingMethod::RCN_225,
+        FunctionMappingMethod::RCN_227_PER_FUNCTION,
+        FunctionMappingMethod::RCN_227_PER_OUTPUT_V1,
+        FunctionMappingMethod::RCN_227_PER_OUTPUT_V2,
+        FunctionMappingMethod::RCN_227_PER_OUTPUT_V3,
+    };
+    srand(5);
+    for (FunctionMappingMethod method : methods) {
+        MemoryCVAccess cvs;
+        writeMixedMapping(cvs, method);
+        AuxController incremental, reloaded;
+        addOutputs(incremental);
+        addOutputs(reloaded);
+        incremental.loadFromCVs(cvs);
+
+        for (int write = 0; write < 20; ++write) {
+            uint16_t page = 0;
+            uint16_t cv = 257 + rand() % 256;
+            switch (method) {
+                case FunctionMappingMethod::RCN_225: cv = CV_OUTPUT_LOCATION_CONFIG_START + rand() % 14; break;
+                case FunctionMappingMethod::RCN_227_PER_FUNCTION: page = RCN227_PER_FUNCTION_PAGE; break;
+                case FunctionMappingMethod::RCN_227_PER_OUTPUT_V1: page = RCN227_PER_OUTPUT_V1_PAGE; break;
+                case FunctionMappingMethod::RCN_227_PER_OUTPUT_V2: page = RCN227_PER_OUTPUT_V2_PAGE; break;
+                default: page = RCN227_PER_OUTPUT_V3_PAGE; break;
+            }
+            uint8_t value = (rand() % 3 == 0) ? 255 : (uint8_t)rand();
+            if (page == 0) cvs.writeCV(cv, value); else cvs.writeIndexedCV(page, cv, value);
+            incremental.reloadCV(cvs, page, cv);
+        }
+        reloaded.loadFromCVs(cvs);
+        reloaded.update(0);
+        CHECK_EQ(incremental._source_key, reloaded._source_key);
+        CHECK_EQ(incremental._logical_functions.size(), reloaded._logical_functions.size());
+
+        srand(23);
+        for (int step = 0; step < 100; ++step) {
+            uint8_t f = (uint8_t)(rand() % MAX_DCC_FUNCTIONS);
+            bool on = rand() % 2;
+            DecoderDirection dir = rand() % 2 ? DECODER_DIRECTION_FORWARD : DECODER_DIRECTION_REVERSE;
+            uint16_t state = (uint16_t)(rand() % 4);
+            for (AuxController* controller : {&incremental, &reloaded}) {
+                controller->setFunctionState(f, on);
+                controller->setDirection(dir);
+                controller->setBinaryState(state, on);
+                controller->update(1);
+            }
+            for (uint8_t output = 1; output <= kNumOutputs; ++output) {
+                CHECK_EQ(outputActive(incremental, output), outputActive(reloaded, output));
+            }
+        }
+    }
+}
+
+static void testCvWriteKeepsOtherOutputsRunning() {
+    AuxController controller;
+    addOutputs(controller);
+    MemoryCVAccess cvs;
+    cvs.writeCV(CV_FUNCTION_MAPPING_METHOD, (uint8_t)FunctionMappingMethod::RCN_227_PER_OUTPUT_V3);
+    for (int cv = 257; cv <= 512; ++cv) cvs.writeIndexedCV(RCN227_PER_OUTPUT_V3_PAGE, cv, 255);
+    for (int output = 0; output < 8; ++output) {
+        cvs.writeIndexedCV(RCN227_PER_OUTPUT_V3_PAGE, 257 + output * 8, (uint8_t)output); // F<n-1> -> output n
+    }
+    // Output 6 strobes.
+    cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, 257 + 5 * 8 + EFFECTS_CV_OFFSET_TYPE, EFFECT_TYPE_STROBE);
+    cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, 257 + 5 * 8 + EFFECTS_CV_OFFSET_PARAM1_LSB, 100);
+    cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, 257 + 5 * 8 + EFFECTS_CV_OFFSET_PARAM2_LSB, 50);
+    cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, 257 + 5 * 8 + EFFECTS_CV_OFFSET_PARAM3_LSB, 255);
+    controller.loadFromCVs(cvs);
+    for (uint8_t f = 0; f < 8; ++f) controller.setFunctionState(f, true);
+    controller.setDirection(DECODER_DIRECTION_REVERSE);
+    controller.setSpeed(40);
+    controller.update(10);
+    std::vector<LogicalFunction*> before = controller._logical_functions;
+    CHECK_EQ(before.size(), 8);
+
+    // Tuning the strobe period replaces only output 6's effect.
+    cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, 257 + 5 * 8 + EFFECTS_CV_OFFSET_PARAM1_LSB, 60);
+    controller.reloadCV(cvs, EFFECTS_BLOCK_PAGE, 257 + 5 * 8 + EFFECTS_CV_OFFSET_PARAM1_LSB);
+    CHECK(controller._logical_functions == before);
+    CHECK(controller.getLogicalFunction(5)->isActive());
+
+    // Remapping output 3 to F9 keeps every logical function object and the decoder state.
+    VirtualHardware::clearEvents();
+    cvs.writeIndexedCV(RCN227_PER_OUTPUT_V3_PAGE, 257 + 2 * 8, 9);
+    controller.reloadCV(cvs, RCN227_PER_OUTPUT_V3_PAGE, 257 + 2 * 8);
+    CHECK(controller._logical_functions == before);
+    CHECK(controller.getFunctionState(7));
+    CHECK_EQ(controller.getDirection(), DECODER_DIRECTION_REVERSE);
+    CHECK_EQ(controller.getSpeed(), 40);
+    controller.update(10);
+    for (int output = 1; output <= 8; ++output) {
+        if (output == 3 || output == 6) continue;
+        CHECK_EQ(VirtualHardware::count(VirtualHardware::EventType::DIGITAL_WRITE, 10 + output), 0);
+        CHECK_EQ(VirtualHardware::count(VirtualHardware::EventType::ANALOG_WRITE, 10 + output), 0);
+    }
+    CHECK(outputOn(1));
+    CHECK(!outputOn(3)); // F9 is off
+    controller.setFunctionState(9, true);
+    controller.update(10);
+    CHECK(outputOn(3));
+
+    // Unmapping output 2 removes its logical function and switches it off.
+    cvs.writeIndexedCV(RCN227_PER_OUTPUT_V3_PAGE, 257 + 1 * 8, 255);
+    controller.reloadCV(cvs, RCN227_PER_OUTPUT_V3_PAGE, 257 + 1 * 8);
+    controller.update(10);
+    CHECK_EQ(controller._logical_functions.size(), 7);
+    CHECK(!outputOn(2));
+    CHECK(outputOn(4));
+    CHECK(controller.getLogicalFunction(2) == before[3]);
+}
+
+static void testReloadKeepsDecoderStateAndOutputs() {
+    AuxController controller;
+    addOutputs(controller);
+    MemoryCVAccess cvs;
+    cvs.writeCV(CV_FUNCTION_MAPPING_METHOD, (uint8_t)FunctionMappingMethod::RCN_225);
+    cvs.writeCV(CV_OUTPUT_LOCATION_CONFIG_START, 1 << 0);     // F0f -> output 1
+    cvs.writeCV(CV_OUTPUT_LOCATION_CONFIG_START + 2, 1 << 2); // F1 -> output 3
+    controller.loadFromCVs(cvs);
+    controller.setFunctionState(0, true);
+    controller.setFunctionState(1, true);
+    controller.setSpeed(80);
+    controller.update(10);
+    CHECK(outputOn(1));
+    CHECK(outputOn(3));
+
+    // The new mapping moves F1 to output 4. Until update() swaps it in, the old one keeps running.
+    cvs.writeCV(CV_OUTPUT_LOCATION_CONFIG_START + 2, 1 << 3);
+    VirtualHardware::clearEvents();
+    controller.loadFromCVs(cvs);
+    CHECK_EQ(controller._lf_outputs[1], 3);
+    CHECK(controller.getLogicalFunction(0)->isActive());
+    CHECK(VirtualHardware::events().empty());
+
+    controller.update(10);
+    CHECK(controller.getFunctionState(1));
+    CHECK_EQ(controller.getSpeed(), 80);
+    CHECK(outputOn(1));
+    CHECK(!outputOn(3));
+    CHECK(outputOn(4));
+    // Output 1 stays lit across the swap; the new effect's identical level is not rewritten.
+    CHECK_EQ(VirtualHardware::count(VirtualHardware::EventType::ANALOG_WRITE, 11) +
+             VirtualHardware::count(VirtualHardware::EventType::DIGITAL_WRITE, 11), 0);
+
+    // A truncated image (with a matching payload hash) leaves the active mapping in place.
+    std::vector<uint8_t> image;
+    CHECK(controller.saveMappingImage(cvs, image));
+    image.resize(MAPPING_IMAGE_HEADER_SIZE + 3);
+    uint32_t hash = mappingImageHash(image.data() + MAPPING_IMAGE_HEADER_SIZE, 3);
+    for (int i = 0; i < 4; ++i) image[8 + i] = (uint8_t)(hash >> (8 * i));
+    CHECK(!controller.loadFromImage(cvs, image));
+    CHECK(!controller._standby_ready);
+    CHECK_EQ(controller._logical_functions.size(), 2);
+    controller.update(10);
+    CHECK(outputOn(4));
+}
+
+static void testReloadKeepsRunningEffects() {
+    MemoryCVAccess cvs;
+    cvs.writeCV(CV_FUNCTION_MAPPING_METHOD, (uint8_t)FunctionMappingMethod::RCN_225);
+    cvs.writeCV(CV_OUTPUT_LOCATION_CONFIG_START, 1 << 0); // F0f -> output 1
+    for (int output = 0; output < 2; ++output) {
+        uint16_t base = 257 + output * EFFECTS_BLOCK_CV_PER_OUTPUT;
+        cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, base + EFFECTS_CV_OFFSET_TYPE, EFFECT_TYPE_SOFT_START_STOP);
+        cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, base + EFFECTS_CV_OFFSET_PARAM1_LSB, 200); // Fade in, ms
+        cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, base + EFFECTS_CV_OFFSET_PARAM2_LSB, 200); // Fade out, ms
+        cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, base + EFFECTS_CV_OFFSET_PARAM3_LSB, 255);
+    }
+    AuxController controller;
+    addOutputs(controller);
+    controller.loadFromCVs(cvs);
+    controller.setFunctionState(0, true);
+    for (int i = 0; i < 30; ++i) controller.update(10);
+    CHECK_EQ(VirtualHardware::pinValue(11), 255);
+
+    // Identical CVs: the running soft start is carried over and does not fade in again.
+    VirtualHardware::clearEvents();
+    controller.loadFromCVs(cvs);
+    controller.update(10);
+    CHECK_EQ(VirtualHardware::pinValue(11), 255);
+    CHECK_EQ(VirtualHardware::count(VirtualHardware::EventType::ANALOG_WRITE, 11), 0);
+
+    // Only the mapping changed (F0 now lights output 2 as well): output 1 keeps its effect,
+    // the new logical function of output 2 fades in.
+    cvs.writeCV(CV_OUTPUT_LOCATION_CONFIG_START, (1 << 0) | (1 << 1));
+    controller.loadFromCVs(cvs);
+    controller.update(10);
+    CHECK_EQ(VirtualHardware::pinValue(11), 255);
+    CHECK(VirtualHardware::pinValue(12) < 255);
+
+    // A changed effect CV builds a new effect.
+    cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, 257 + EFFECTS_CV_OFFSET_PARAM3_LSB, 128);
+    controller.loadFromCVs(cvs);
+    controller.update(10);
+    CHECK(VirtualHardware::pinValue(11) < 128);
+}
+
+int main() {
+    RUN_TEST(testConditionStateSetMasks);
+    RUN_TEST(testRcn225);
+    RUN_TEST(testRcn227PerFunctionBlocking);
+    RUN_TEST(testRcn227PerOutputV1WideMatrix);
+    RUN_TEST(testRcn227PerOutputV2);
+    RUN_TEST(testRcn227PerOutputV3);
+    RUN_TEST(testFunctionMaskTerm);
+    RUN_TEST(testIncrementalEvaluationMatchesFullEvaluation);
+    RUN_TEST(testLevelAndToggleActions);
+    RUN_TEST(testLogicalFunctionStateSettlesInOneUpdate);
+    RUN_TEST(testUnreadInputsDoNotTriggerEvaluation);
+    RUN_TEST(testLoadFetchesEachPageOnce);
+    RUN_TEST(testShadowedLoadDoesNotWriteBackingStore);
+    RUN_TEST(testMappingImageRoundTrip);
+    RUN_TEST(testStaleOrCorruptImageIsRejected);
+    RUN_TEST(testMaximumImageIsCompactAndStreams);
+    RUN_TEST(testOneLogicalFunctionPerOutput);
+    RUN_TEST(testIdenticalPredicatesAreShared);
+    RUN_TEST(testSingleCvWritesMatchFullReload);
+    RUN_TEST(testCvWriteKeepsOtherOutputsRunning);
+    RUN_TEST(testReloadKeepsDecoderStateAndOutputs);
+    RUN_TEST(testReloadKeepsRunningEffects);
+    return TEST_MAIN_RESULT();
+}
@@ -0,0 +1,410 @@
+#include <algorithm>
+#include <Arduino.h>
+#include <MemoryCVAccess.h>
+#include "xDuinoRails_DccLightsAndFunctions.h"
+#include "cv_definitions.h"
+#include "effects/Effect.h"
+#include "LightSources/CharlieplexedLeds.h"
+#include "LightSources/DualColorLed.h"
+#include "LightSources/NeopixelRgbMulti.h"
+#include "LightSources/NeopixelStrip.h"
+#include "LightSources/SingleLed.h"
+#include "LightSources/SoftPwmLed.h"
+#include "TestSupport.h"
+
+using namespace xDuinoRails;
+using VirtualHardware::EventType;
+
+// Maps F0 forward to output 1 with the given effect type.
+static void loadF0ToOutput1(AuxController& controller, uint8_t effect_type) {
+    MemoryCVAccess cvs;
+    cvs.writeCV(CV_FUNCTION_MAPPING_METHOD, (uint8_t)FunctionMappingMethod::RCN_225);
+    cvs.writeCV(CV_OUTPUT_LOCATION_CONFIG_START, 1 << 0);
+    cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, 257 + EFFECTS_CV_OFFSET_TYPE, effect_type);
+    cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, 257 + EFFECTS_CV_OFFSET_PARAM1_LSB, 200);
+    cvs.writeIndexedCV(EFFECTS_BLOCK_PAGE, 257 + EFFECTS_CV_OFFSET_PARAM2_LSB, 40);
+    controller.loadFromCVs(cvs);
+}
+
+static void testStripIsShownOncePerUpdate() {
+    AuxController controller;
+    controller.addLightSource(std::unique_ptr<LightSource>(new NeopixelRgbMulti(6, 4, 255, 255, 255)));
+    loadF0ToOutput1(controller, EFFECT_TYPE_DIMMING);
+    VirtualHardware::clearEvents();
+
+    controller.setFunctionState(0, true);
+    controller.update(10);
+    // setValue() calls on() and setLevel(); both only buffer, the commit pass transmits once.
+    CHECK_EQ(VirtualHardware::count(EventType::STRIP_SHOW, 6), 1);
+}
+
+static void testSegmentsShareOneStripTransmission() {
+    NeopixelStrip strip(6, 7);
+    AuxController controller;
+    controller.addLightSource(std::unique_ptr<LightSource>(new NeopixelSegment(strip, 0, 3, 255, 255, 255)));
+    controller.addLightSource(std::unique_ptr<LightSource>(new NeopixelSegment(strip, 3, 2, 255, 0, 0, 2)));
+    controller.addLightSource(std::unique_ptr<LightSource>(new NeopixelSegment(strip, 6, 1, 255, 200, 100)));
+    CHECK_EQ(VirtualHardware::count(EventType::STRIP_SHOW, 6), 1); // begin() shows the strip once
+
+    MemoryCVAccess cvs;
+    cvs.writeCV(CV_FUNCTION_MAPPING_METHOD, (uint8_t)FunctionMappingMethod::RCN_225);
+    cvs.writeCV(CV_OUTPUT_LOCATION_CONFIG_START, 1 << 0);     // F0f -> output 1
+    cvs.writeCV(CV_OUTPUT_LOCATION_CONFIG_START + 1, 1 << 1); // F0r -> output 2
+    cvs.writeCV(CV_OUTPUT_LOCATION_CONFIG_START + 2, 1 << 2); // F1 -> output 3
+    controller.loadFromCVs(cvs);
+    VirtualHardware::clearEvents();
+
+    controller.setFunctionState(0, true);
+    controller.setFunctionState(1, true);
+    controller.setDirection(DECODER_DIRECTION_REVERSE);
+    controller.update(10);
+    CHECK_EQ(VirtualHardware::count(EventType::STRIP_SHOW, 6), 1);
+    CHECK_EQ(strip.getPixelColor(0), 0);
+    CHECK_EQ(strip.getPixelColor(3), 0xFF0000);
+    CHECK_EQ(strip.getPixelColor(4), 0);
+    CHECK_EQ(strip.getPixelColor(5), 0xFF0000);
+    CHECK_EQ(strip.getPixelColor(6), 0xFFC864);
+    controller.update(10);
+    CHECK_EQ(VirtualHardware::count(EventType::STRIP_SHOW, 6), 1);
+}
+
+static void testUnchangedValuesAreNotWrittenAgain() {
+    AuxController controller;
+    controller.addPhysicalOutput(3, OutputType::LIGHT_SOURCE);
+    loadF0ToOutput1(controller, EFFECT_TYPE_NONE);
+    controller.setFunctionState(0, true);
+    controller.update(10);
+    CHECK_EQ(VirtualHardware::pinValue(3), 255);
+    VirtualHardware::clearEvents();
+
+    for (int i = 0; i < 10; ++i) controller.update(10);
+    CHECK_EQ(VirtualHardware::count(EventType::DIGITAL_WRITE, 3), 0);
+    CHECK_EQ(VirtualHardware::count(EventType::ANALOG_WRITE, 3), 0);
+
+    // Effects that keep running re-send their level every update; only the first reaches the pin.
+    PhysicalOutput led(std::unique_ptr<LightSource>(new SingleLed(4)));
+    led.begin();
+    for (int i = 0; i < 10; ++i) {
+        led.setValue(128);
+        led.commit();
+    }
+    CHECK_EQ(VirtualHardware::count(EventType::ANALOG_WRITE, 4), 1);
+    CHECK_EQ(led.getElidedWriteCount(), 9);
+}
+
+static void testCombineModes() {
+    PhysicalOutput led(std::unique_ptr<LightSource>(new SingleLed(4)));
+    led.setBrightnessCurve(BrightnessCurve::LINEAR);
+    led.begin();
+    int base, dimmer, other;
+    led.selectSource(&base);
+    led.setValue(200);
+    led.selectSource(&dimmer, 1);
+    led.setValue(64);
+    led.selectSource(&other);
+    led.setValue(100);
+    led.commit();
+    CHECK_EQ(VirtualHardware::pinValue(4), 200);
+
+    const struct { CombineMode mode; int expected; } cases[] = {
+        {CombineMode::MAX, 200},
+        {CombineMode::PRIORITY, 64},
+        {CombineMode::ADD, 255},
+        {CombineMode::MULTIPLY, 200 * 64 / 255},
+    };
+    for (const auto& c : cases) {
+        led.setCombineMode(c.mode);
+        led.commit();
+        CHECK_EQ(VirtualHardware::pinValue(4), c.expected);
+    }
+
+    // An idle dimmer does not dim, and removed sources no longer count.
+    led.selectSource(&dimmer, 1);
+    led.setValue(0);
+    led.commit();
+    CHECK_EQ(VirtualHardware::pinValue(4), 200);
+    led.removeSource(&base);
+    led.commit();
+    CHECK_EQ(VirtualHardware::pinValue(4), 100);
+    led.removeSource(&other);
+    led.commit();
+    CHECK_EQ(VirtualHardware::pinValue(4), 0);
+}
+
+static void testSharedOutputIsWrittenOncePerFrame() {
+    AuxController controller;
+    controller.addPhysicalOutput(3, OutputType::LIGHT_SOURCE);
+    loadF0ToOutput1(controller, EFFECT_TYPE_NONE);
+    controller.update(0);
+    // F3 dims the headlight on output 1 to a quarter.
+    LogicalFunction* dimmer = new LogicalFunction(new EffectSteady(64));
+    dimmer->addOutput(controller.getOutputById(1));
+    dimmer->setPriority(1);
+    controller.addLogicalFunction(dimmer);
+    ConditionVariable f3;
+    f3.id = 1;
+    f3.conditions.push_back({TriggerSource::FUNC_KEY, TriggerComparator::IS_TRUE, 3});
+    MappingRule rule;
+    rule.target_logical_function_id = 1;
+    rule.positive_conditions.push_back(controller.addConditionVariable(f3));
+    rule.action = MappingAction::ACTIVATE;
+    controller.addMappingRule(rule);
+    controller.compileMapping();
+    controller.setCombineMode(1, CombineMode::MULTIPLY);
+    controller.setBrightnessCurve(1, BrightnessCurve::LINEAR);
+
+    controller.setFunctionState(0, true);
+    controller.update(10);
+    CHECK_EQ(VirtualHardware::pinValue(3), 255);
+    VirtualHardware::clearEvents();
+    controller.setFunctionState(3, true);
+    controller.update(10);
+    CHECK_EQ(VirtualHardware::pinValue(3), 64);
+    CHECK_EQ(VirtualHardware::count(EventType::ANALOG_WRITE, 3), 1); // Only the combined level is written
+    controller.setFunctionState(0, false);
+    controller.update(10);
+    CHECK_EQ(VirtualHardware::pinValue(3), 0);
+}
+
+static void testBrightnessCurve() {
+    CHECK_EQ(applyBrightnessCurve(BrightnessCurve::LINEAR, 100), 100);
+    CHECK_EQ(applyBrightnessCurve(BrightnessCurve::CIE1931, 0), 0);
+    CHECK_EQ(applyBrightnessCurve(BrightnessCurve::CIE1931, 1), 1); // On stays on
+    CHECK_EQ(applyBrightnessCurve(BrightnessCurve::CIE1931, 128 * 257), 12179);
+    CHECK_EQ(applyBrightnessCurve(BrightnessCurve::CIE1931, 0xFFFF), 0xFFFF);
+    uint16_t previous = 0;
+    for (uint32_t level = 1; level <= 0xFFFF; level += 7) {
+        uint16_t value = applyBrightnessCurve(BrightnessCurve::CIE1931, (uint16_t)level);
+        CHECK(value >= previous);
+        previous = value;
+    }
+
+    // The curve is applied once, to the combined level; switching sources stay linear.
+    AuxController controller;
+    controller.addPhysicalOutput(3, OutputType::LIGHT_SOURCE);
+    loadF0ToOutput1(controller, EFFECT_TYPE_DIMMING);
+    controller.setFunctionState(0, true);
+    CHECK_EQ(controller.update(10), UPDATE_NEXT_TICK); // Level 200 lies between 8-bit steps
+    CHECK_EQ(VirtualHardware::pinValue(3), 137);
+    CHECK_EQ(controller.update(10), UPDATE_IDLE);
+    CHECK_EQ(VirtualHardware::pinValue(3), 138);
+    controller.setBrightnessCurve(1, BrightnessCurve::LINEAR);
+    controller.update(10);
+    CHECK_EQ(VirtualHardware::pinValue(3), 200);
+
+    PhysicalOutput bicolor(std::unique_ptr<LightSource>(new DualColorLed(7, 8)));
+    bicolor.begin();
+    bicolor.setValue(1);
+    bicolor.commit();
+    CHECK_EQ(VirtualHardware::pinValue(7), HIGH);
+}
+
+static void testSixteenBitLevelsAreDithered() {
+    PhysicalOutput led(std::unique_ptr<LightSource>(new SingleLed(4)));
+    led.setBrightnessCurve(BrightnessCurve::LINEAR);
+    led.begin();
+    // A quarter step above 10: three frames at 10, one at 11.
+    uint32_t sum = 0;
+    for (int frame = 0; frame < 8; ++frame) {
+        led.setValue16(10 * 257 + 64 + (frame & 1)); // The level keeps changing, as in a fade
+        CHECK_EQ(led.render(), UPDATE_NEXT_TICK);
+        sum += VirtualHardware::pinValue(4);
+    }
+    CHECK_EQ(sum, 8 * 10 + 2);
+    // Once the level holds still, it settles to the nearest step.
+    CHECK_EQ(led.render(), UPDATE_IDLE);
+    CHECK_EQ(VirtualHardware::pinValue(4), 10);
+    CHECK_EQ(led.render(), UPDATE_IDLE);
+
+    // A slow soft start passes through every 8-bit step instead of holding each for 256 ms.
+    PhysicalOutput fade(std::unique_ptr<LightSource>(new SingleLed(5)));
+    fade.setBrightnessCurve(BrightnessCurve::LINEAR);
+    fade.begin();
+    std::vector<PhysicalOutput*> outputs = {&fade};
+    EffectSoftStartStop effect(65280, 0, 255); // 1 unit of 8.8 per ms
+    effect.setActive(true);
+    int changes = 0;
+    uint32_t previous = 0;
+    for (int ms = 0; ms < 512; ++ms) {
+        effect.update(1, outputs);
+        fade.commit();
+        if (VirtualHardware::pinValue(5) != previous) ++changes;
+        previous = VirtualHardware::pinValue(5);
+    }
+    CHECK(changes > 100); // Dithers between 1 and 2 instead of stepping once
+}
+
+static void testSoftPwmDutyCycles() {
+    SoftPwm pwm; // 32 us ticks, 8160 us frames
+    uint8_t pins[] = {2, 3, 12};
+    uint8_t levels[] = {64, 255, 1};
+    std::vector<std::unique_ptr<PhysicalOutput>> leds;
+    for (int i = 0; i < 3; ++i) {
+        leds.emplace_back(new PhysicalOutput(std::unique_ptr<LightSource>(new SoftPwmLed(pwm, pins[i]))));
+        leds[i]->setBrightnessCurve(BrightnessCurve::LINEAR);
+        leds[i]->begin();
+        leds[i]->setValue(levels[i]);
+        leds[i]->commit();
+    }
+    uint64_t frame_start = VirtualHardware::nowMicros() + 32; // The first tick starts a frame
+    VirtualHardware::advanceMicros(32 + 2 * 8160);
+    uint64_t second_frame = frame_start + 8160;
+    for (int i = 0; i < 3; ++i) {
+        CHECK_EQ(VirtualHardware::highTimeMicros(pins[i], second_frame, second_frame + 8160), levels[i] * 32);
+    }
+    // Level 64 is one bit: on for bit 6 only. Level 1 is on for bit 0 only.
+    int writes[3] = {};
+    for (const auto& e : VirtualHardware::events()) {
+        if (e.type != EventType::DIGITAL_WRITE || e.time_us < second_frame || e.time_us >= second_frame + 8160) continue;
+        for (int i = 0; i < 3; ++i) writes[i] += e.id == pins[i];
+    }
+    CHECK_EQ(writes[0], 2);
+    CHECK_EQ(writes[1], 0);
+    CHECK_EQ(writes[2], 2);
+
+    // A new level applies from the next bit change on.
+    leds[1]->setValue(0);
+    leds[1]->commit();
+    VirtualHardware::advanceMicros(32);
+    CHECK_EQ(VirtualHardware::pinValue(3), 0);
+}
+
+// Counts, per LED, the ticks in which it is lit (anode driven HIGH, cathode driven LOW).
+static void countLitTicks(const std::vector<uint8_t>& pins, int ticks, std::vector<int>& lit) {
+    size_t per_row = pins.size() - 1;
+    for (int t = 0; t < ticks; ++t) {
+        VirtualHardware::advanceMicros(32);
+        for (size_t led = 0; led < lit.size(); ++led) {
+            size_t anode = led / per_row;
+            size_t cathode = led % per_row;
+            if (cathode >= anode) ++cathode;
+            if (VirtualHardware::modeOf(pins[anode]) == OUTPUT && VirtualHardware::pinValue(pins[anode]) == HIGH &&
+                VirtualHardware::modeOf(pins[cathode]) == OUTPUT && VirtualHardware::pinValue(pins[cathode]) == LOW) {
+                ++lit[led];
+            }
+        }
+    }
+}
+
+static void testCharlieplexScanIsDimmedFromTheTick() {
+    SoftPwm pwm;
+    std::vector<uint8_t> pins = {2, 3, 4, 5, 6};
+    CharlieplexedLeds leds(pwm, pins); // 20 LEDs, 5 rows of 31 ticks
+    leds.begin();
+    leds.setLevel(255);
+    for (uint8_t led = 0; led < leds.ledCount(); ++led) leds.setLedLevel(led, 0);
+    leds.setLedLevel(0, 255);
+    leds.setLedLevel(5, 128);
+    leds.setLedLevel(19, 8);
+    leds.commit();
+
+    std::vector<int> lit(20, 0);
+    countLitTicks(pins, 155, lit);
+    CHECK_EQ(lit[0], 31);
+    CHECK_EQ(lit[5], 16);
+    CHECK_EQ(lit[19], 1); // Rounds to the lowest step, not to off
+    int others = 0;
+    for (int led = 0; led < 20; ++led) others += (led != 0 && led != 5 && led != 19) ? lit[led] : 0;
+    CHECK_EQ(others, 0);
+
+    // A frame committed mid-scan waits for the next scan frame.
+    std::fill(lit.begin(), lit.end(), 0);
+    countLitTicks(pins, 70, lit);
+    leds.setLedLevel(19, 255);
+    leds.commit();
+    countLitTicks(pins, 85, lit);
+    CHECK_EQ(lit[19], 1);
+    std::fill(lit.begin(), lit.end(), 0);
+    countLitTicks(pins, 155, lit);
+    CHECK_EQ(lit[19], 31);
+
+    leds.setLevel(128); // The output level scales every LED
+    leds.commit();
+    std::fill(lit.begin(), lit.end(), 0);
+    countLitTicks(pins, 155, lit);
+    CHECK_EQ(lit[0], 16);
+    CHECK_EQ(lit[5], 8);
+    leds.off();
+    leds.commit();
+    std::fill(lit.begin(), lit.end(), 0);
+    countLitTicks(pins, 155, lit);
+    CHECK_EQ(lit[0], 0);
+}
+
+static void testCharlieplexOutputLightsAllLeds() {
+    // Without per-LED levels an output lights every LED, scanned from a SoftPwm of its own.
+    std::vector<uint8_t> pins = {2, 3, 4};
+    PhysicalOutput output{std::unique_ptr<LightSource>(new CharlieplexedLeds(pins))};
+    output.begin();
+    output.setValue(255);
+    output.commit();
+    std::vector<int> lit(6, 0);
+    countLitTicks(pins, 93, lit);
+    for (int led = 0; led < 6; ++led) CHECK_EQ(lit[led], 31);
+    output.setValue(0);
+    output.commit();
+    std::fill(lit.begin(), lit.end(), 0);
+    countLitTicks(pins, 93, lit);
+    CHECK_EQ(std::count(lit.begin(), lit.end(), 0), 6);
+}
+
+static void testDualColorLedMixesFromTheTick() {
+    SoftPwm pwm;
+    DualColorLed* led = new DualColorLed(pwm, 7, 8);
+    PhysicalOutput output{std::unique_ptr<LightSource>(led)};
+    output.setBrightnessCurve(BrightnessCurve::LINEAR);
+    output.begin();
+    led->setColorMix(64); // A quarter of colour 2
+    output.setValue(200);
+    output.commit();
+
+    uint64_t frame_start = VirtualHardware::nowMicros() + 32;
+    bool both = false;
+    for (int t = 0; t < 255; ++t) {
+        VirtualHardware::advanceMicros(32);
+        both = both || (VirtualHardware::pinValue(7) && VirtualHardware::pinValue(8));
+    }
+    CHECK(!both);
+    CHECK_EQ(VirtualHardware::highTimeMicros(7, frame_start, frame_start + 8160), 150 * 32);
+    CHECK_EQ(VirtualHardware::highTimeMicros(8, frame_start, frame_start + 8160), 50 * 32);
+
+    // setColor() picks one end of the mix at the current level; it applies from the next frame.
+    output.setValue(100);
+    output.commit();
+    led->setColor(DualColorLedState::Color2);
+    led->commit();
+    frame_start += 8160;
+    VirtualHardware::advanceMicros(8160);
+    CHECK_EQ(VirtualHardware::highTimeMicros(7, frame_start, frame_start + 8160), 0);
+    CHECK_EQ(VirtualHardware::highTimeMicros(8, frame_start, frame_start + 8160), 100 * 32);
+    output.setValue(0);
+    output.commit();
+    VirtualHardware::advanceMicros(8160);
+    CHECK_EQ(VirtualHardware::pinValue(7) + VirtualHardware::pinValue(8), 0);
+}
+
+static void testServoAngleIsNotRewritten() {
+    PhysicalOutput servo(9);
+    servo.begin();
+    servo.setServoAngle(45);
+    servo.setServoAngle(45);
+    servo.setServoAngle(46);
+    CHECK_EQ(VirtualHardware::count(EventType::SERVO_WRITE, 9), 2);
+    CHECK_EQ(servo.getElidedWriteCount(), 1);
+}
+
+int main() {
+    RUN_TEST(testStripIsShownOncePerUpdate);
+    RUN_TEST(testSegmentsShareOneStripTransmission);
+    RUN_TEST(testUnchangedValuesAreNotWrittenAgain);
+    RUN_TEST(testCombineModes);
+    RUN_TEST(testSharedOutputIsWrittenOncePerFrame);
+    RUN_TEST(testBrightnessCurve);
+    RUN_TEST(testSixteenBitLevelsAreDithered);
+    RUN_TEST(testSoftPwmDutyCycles);
+    RUN_TEST(testCharlieplexScanIsDimmedFromTheTick);
+    RUN_TEST(testCharlieplexOutputLightsAllLeds);
+    RUN_TEST(testDualColorLedMixesFromTheTick);
+    RUN_TEST(testServoAngleIsNotRewritten);
+    return TEST_MAIN_RESULT();
+}
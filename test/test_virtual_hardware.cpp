@@ -0,0 +1,110 @@
+#include <Arduino.h>
+#include <FastLED.h>
+#include <MemoryCVAccess.h>
+#include "xDuinoRails_DccLightsAndFunctions.h"
+#include "cv_definitions.h"
+#include "LightSources/SingleLed.h"
+#include "LightSources/Neopixel.h"
+#include "TestSupport.h"
+
+using namespace xDuinoRails;
+using VirtualHardware::EventType;
+
+static void testPinAccessIsRecordedWithTimestamps() {
+    pinMode(5, OUTPUT);
+    VirtualHardware::advanceMillis(10);
+    digitalWrite(5, HIGH);
+    VirtualHardware::advanceMicros(250);
+    analogWrite(5, 128);
+
+    const auto& events = VirtualHardware::events();
+    CHECK_EQ(events.size(), 3);
+    CHECK(events[0].type == EventType::PIN_MODE);
+    CHECK_EQ(events[1].time_us, 10000);
+    CHECK(events[2].type == EventType::ANALOG_WRITE);
+    CHECK_EQ(events[2].time_us, 10250);
+    CHECK_EQ(events[2].value, 128);
+    CHECK_EQ(VirtualHardware::pinValue(5), 128);
+    CHECK_EQ(millis(), 10);
+}
+
+static void testServoAndStripAreRecorded() {
+    AuxController controller;
+    controller.addPhysicalOutput(9, OutputType::SERVO);
+    controller.addLightSource(std::unique_ptr<LightSource>(new Neopixel(6, 0xFFFFFF)));
+    CHECK_EQ(VirtualHardware::count(EventType::SERVO_ATTACH, 9), 1);
+    CHECK_EQ(VirtualHardware::count(EventType::STRIP_SHOW, 6), 1);
+}
+
+static void testRcn225MappingDrivesVirtualPins() {
+    AuxController controller;
+    controller.addPhysicalOutput(3, OutputType::LIGHT_SOURCE); // output 1
+    controller.addPhysicalOutput(4, OutputType::LIGHT_SOURCE); // output 2
+
+    MemoryCVAccess cvs;
+    cvs.writeCV(CV_FUNCTION_MAPPING_METHOD, (uint8_t)FunctionMappingMethod::RCN_225);
+    cvs.writeCV(CV_OUTPUT_LOCATION_CONFIG_START, 1 << 0);     // F0f -> output 1
+    cvs.writeCV(CV_OUTPUT_LOCATION_CONFIG_START + 1, 1 << 1); // F0r -> output 2
+    controller.loadFromCVs(cvs);
+
+    controller.setFunctionState(0, true);
+    controller.setDirection(DECODER_DIRECTION_FORWARD);
+    controller.update(10);
+    CHECK_EQ(VirtualHardware::pinValue(3), 255);
+    CHECK_EQ(VirtualHardware::pinValue(4), 0);
+}
+
+static void testFastLedHelpersStayInRange() {
+    random16_set_seed(42);
+    for (int i = 0; i < 1000; ++i) {
+        CHECK(random8(10, 20) >= 10 && random8(10, 20) < 20);
+    }
+    uint8_t previous = inoise8(0);
+    for (uint16_t x = 1; x < 2048; ++x) {
+        uint8_t value = inoise8(x);
+        int step = (int)value - (int)previous;
+        CHECK(step < 8 && step > -8);
+        previous = value;
+    }
+    CHECK_EQ(sin8(64), 255);
+    CHECK_EQ(scale8(255, 127), 127);
+}
+
+static int s_timer_calls = 0;
+
+static void testVirtualTimerAndPorts() {
+    VirtualHardware::attachTimer(100, [] { ++s_timer_calls; });
+    VirtualHardware::advanceMillis(1);
+    CHECK_EQ(s_timer_calls, 10);
+    VirtualHardware::detachTimer();
+    VirtualHardware::advanceMillis(1);
+    CHECK_EQ(s_timer_calls, 10);
+
+    // Port 1 holds pins 8..15; only the pins whose bit changes are recorded.
+    VirtualHardware::clearEvents();
+    *portOutputRegister(digitalPinToPort(9)) = 0x06;
+    CHECK_EQ(VirtualHardware::pinValue(9), 1);
+    CHECK_EQ(VirtualHardware::pinValue(10), 1);
+    *portOutputRegister(1) |= digitalPinToBitMask(8);
+    *portOutputRegister(1) &= (uint8_t)~0x04;
+    CHECK_EQ(*portOutputRegister(1), 0x03);
+    CHECK_EQ(VirtualHardware::count(EventType::DIGITAL_WRITE), 4);
+    *portModeRegister(1) = 0x01;
+    CHECK_EQ(VirtualHardware::modeOf(8), OUTPUT);
+
+    uint64_t start = VirtualHardware::nowMicros();
+    VirtualHardware::advanceMicros(300);
+    digitalWrite(9, LOW);
+    VirtualHardware::advanceMicros(700);
+    CHECK_EQ(VirtualHardware::highTimeMicros(9, start, start + 1000), 300);
+    CHECK_EQ(VirtualHardware::highTimeMicros(8, start, start + 1000), 1000);
+}
+
+int main() {
+    RUN_TEST(testPinAccessIsRecordedWithTimestamps);
+    RUN_TEST(testServoAndStripAreRecorded);
+    RUN_TEST(testRcn225MappingDrivesVirtualPins);
+    RUN_TEST(testFastLedHelpersStayInRange);
+    RUN_TEST(testVirtualTimerAndPorts);
+    return TEST_MAIN_RESULT();
+}